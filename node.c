@@ -8,6 +8,12 @@
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-queue.h"
 
+#include "ql-fixed-point.h"
+#include "ql-checkpoint.h"
+#include "ql-reward.h"
+#include "ql-learner.h"
+#include "ql-exploration.h"
+
 #include "sys/log.h"
 #define LOG_MODULE "App"
 #define LOG_LEVEL LOG_LEVEL_INFO
@@ -18,13 +24,135 @@
 // period to send a packet to the udp server
 #define SEND_INTERVAL (PACKET_SENDING_INTERVAL * CLOCK_SECOND)
 
-// period to update the policy
-#if UPDATE_POLICY_INTERVAL_CONF == 0
-#define UPDATE_POLICY_INTERVAL (CLOCK_SECOND * (EXTRA_TIME + UNICAST_SLOTFRAME_LENGTH + BROADCAST_SLOTFRAME_LENGTH) / 100)
+// maximum number of Tx cells a node can hold in the unicast slotframe
+#ifdef QL_MAX_TX_CELLS_CONF
+#define QL_MAX_TX_CELLS QL_MAX_TX_CELLS_CONF
+#else
+#define QL_MAX_TX_CELLS 1
+#endif
+
+// number of parents a learned state is kept for, the least recently used one is reused when all are taken
+#ifdef QL_NUM_Q_TABLES_CONF
+#define QL_NUM_Q_TABLES QL_NUM_Q_TABLES_CONF
+#else
+#define QL_NUM_Q_TABLES 1
+#endif
+
+// dead band (in packets) around the number of Tx cells before it grows or shrinks
+#ifdef QL_TX_CELLS_HYSTERESIS_CONF
+#define QL_TX_CELLS_HYSTERESIS QL_TX_CELLS_HYSTERESIS_CONF
+#else
+#define QL_TX_CELLS_HYSTERESIS 1
+#endif
+
+// share a cell occupancy bitmap with the neighbours, so exploration also avoids two-hop traffic
+#ifdef QL_OCCUPANCY_SHARING_CONF
+#define QL_OCCUPANCY_SHARING QL_OCCUPANCY_SHARING_CONF
+#else
+#define QL_OCCUPANCY_SHARING 0
+#endif
+
+// report the skipped slot counters to the root in the data packets (after the packet number)
+#ifdef QL_SKIPPED_SLOTS_REPORT_CONF
+#define QL_SKIPPED_SLOTS_REPORT QL_SKIPPED_SLOTS_REPORT_CONF
+#else
+#define QL_SKIPPED_SLOTS_REPORT 0
+#endif
+
+// listen only in the Rx cells that received frames recently, the others are pruned and probed now and then
+#ifdef QL_RX_PRUNING_CONF
+#define QL_RX_PRUNING QL_RX_PRUNING_CONF
+#else
+#define QL_RX_PRUNING 0
+#endif
+
+#if QL_RX_PRUNING
+// slotframes without a reception before an Rx cell is pruned
+#ifdef QL_RX_PRUNING_IDLE_CYCLES_CONF
+#define QL_RX_PRUNING_IDLE_CYCLES QL_RX_PRUNING_IDLE_CYCLES_CONF
+#else
+#define QL_RX_PRUNING_IDLE_CYCLES 512
+#endif
+
+// a pruned cell listens again for PROBE_LEN slotframes out of every PROBE_INTERVAL,
+// so that new children are heard (the probes of the timeslots are staggered). Outside of its probes
+// a pruned cell hears nothing, so a new child sending there sees failures and its learner moves on
+// to the cells this node listens in, which are already used: a longer PROBE_LEN finds new children
+// faster and spreads them better, at the cost of more idle listening
+
+#ifdef QL_RX_PRUNING_PROBE_INTERVAL_CONF
+#define QL_RX_PRUNING_PROBE_INTERVAL QL_RX_PRUNING_PROBE_INTERVAL_CONF
+#else
+#define QL_RX_PRUNING_PROBE_INTERVAL 64
+#endif
+
+#ifdef QL_RX_PRUNING_PROBE_LEN_CONF
+#define QL_RX_PRUNING_PROBE_LEN QL_RX_PRUNING_PROBE_LEN_CONF
+#else
+#define QL_RX_PRUNING_PROBE_LEN 8
+#endif
+#endif /* QL_RX_PRUNING */
+
+// stop learning once the Tx cells are stable and successful, only watch for failures afterwards
+#ifdef QL_CONVERGENCE_CONF
+#define QL_CONVERGENCE QL_CONVERGENCE_CONF
 #else
-#define UPDATE_POLICY_INTERVAL UPDATE_POLICY_INTERVAL_CONF
+#define QL_CONVERGENCE 0
 #endif
 
+#if QL_CONVERGENCE
+// Tx outcomes in the greedy (highest value) cells over which these cells must stay the same and succeed
+// before hibernating, failures are counted over as many Tx outcomes while hibernating
+#ifdef QL_CONVERGENCE_WINDOW_CONF
+#define QL_CONVERGENCE_WINDOW QL_CONVERGENCE_WINDOW_CONF
+#else
+#define QL_CONVERGENCE_WINDOW 32
+#endif
+
+// minimum Tx success rate (in percent) over the window to count as converged
+#ifdef QL_CONVERGENCE_SUCCESS_RATE_CONF
+#define QL_CONVERGENCE_SUCCESS_RATE QL_CONVERGENCE_SUCCESS_RATE_CONF
+#else
+#define QL_CONVERGENCE_SUCCESS_RATE 95
+#endif
+
+// packets lost (every transmission failed) within a window that wake the learning up again; failed
+// retries of a packet that gets through in the end do not count
+#ifdef QL_CONVERGENCE_FAILURE_BURST_CONF
+#define QL_CONVERGENCE_FAILURE_BURST QL_CONVERGENCE_FAILURE_BURST_CONF
+#else
+#define QL_CONVERGENCE_FAILURE_BURST 3
+#endif
+#endif /* QL_CONVERGENCE */
+
+// Tx outcomes the learner learns from: sent in a cell of the QL slotframe, and not the continuation of
+// a burst (those are sent in the next timeslots, the cells of other nodes, not in the learned cell)
+#define QL_LEARNED_OUTCOME(o) ((o).channel_offset < QL_NUM_CHANNEL_OFFSETS && (o).burst == 0)
+
+#if QL_OCCUPANCY_SHARING
+// link-local port of the occupancy bitmaps
+#define QL_OCCUPANCY_PORT 8766
+// one bit per (timeslot, channel offset) cell
+#define QL_OCCUPANCY_BITMAP_SIZE ((QL_NUM_ACTIONS + 7) / 8)
+// APT occupancy from which a cell is reported busy (QL_APT_ONE / 16: a single reception is reported for
+// about 5 decay periods, steady traffic all the time)
+#ifdef QL_OCCUPANCY_BUSY_LEVEL_CONF
+#define QL_OCCUPANCY_BUSY_LEVEL QL_OCCUPANCY_BUSY_LEVEL_CONF
+#else
+#define QL_OCCUPANCY_BUSY_LEVEL (QL_APT_ONE / 16)
+#endif
+// the same level in the 8-bit view of get_apt_table()
+#define QL_OCCUPANCY_BUSY_TABLE MAX(1, QL_OCCUPANCY_BUSY_LEVEL * 255 / QL_APT_TABLE_FULL)
+#endif /* QL_OCCUPANCY_SHARING */
+
+// skipped slot counters: per cause, then per slotframe (handles 0 to QL_SKIPPED_SLOTS_HANDLES - 1, then the others)
+// without the locked wake-ups, which have no slotframe
+#define QL_SKIPPED_SLOTS_COUNTERS (TSCH_QL_SKIP_NUM + QL_SKIPPED_SLOTS_HANDLES + 1)
+#if QL_SKIPPED_SLOTS_REPORT
+// the counters follow the packet number and the two marker bytes, 16 bits each
+#define QL_SKIPPED_SLOTS_REPORT_OFFSET 4
+#endif /* QL_SKIPPED_SLOTS_REPORT */
+
 // UDP communication process
 PROCESS(node_udp_process, "UDP communicatio process");
 // Q-Learning and scheduling process
@@ -39,29 +167,304 @@ unsigned char custom_payload[UDP_PLAYLOAD_SIZE];
 struct tsch_slotframe *sf_broadcast;
 struct tsch_slotframe *sf_unicast;
 
-// array to store the links of the unicast slotframe
+// array to store the links of the unicast slotframe (one per timeslot), a queued add fills in its entry
+// from the slot operation
 struct tsch_link *links_unicast_sf[UNICAST_SLOTFRAME_LENGTH];
 
-// a variable to store the current action number
-uint8_t current_action = 0;
+// a variable to store the current action number (the primary Tx cell)
+uint16_t current_action = 0;
 
-// array to store Q-values of the actions (or timeslots)
-float q_values[UNICAST_SLOTFRAME_LENGTH];
+// all the Tx cells in use, tx_actions[0] is current_action
+uint16_t tx_actions[QL_MAX_TX_CELLS];
+uint8_t num_tx_cells = 1;
 
-// reward values
-int reward_succes = 1;
-int reward_failure = 0;
+// number of Tx cells wanted for the current backlog to the parent
+uint8_t wanted_tx_cells = 1;
+
+// learned state per parent (time source), the learner holds the one of the current parent
+struct q_table {
+  linkaddr_t parent;    // linkaddr_null until the table is bound to a parent
+  uint32_t last_used;
+  uint16_t state_len;   // 0 while no state was saved
+  uint8_t state[QL_LEARNER_STATE_MAX];
+};
+struct q_table q_tables[QL_NUM_Q_TABLES];
+uint32_t q_tables_clock = 0;
+struct q_table *current_q_table = &q_tables[0];
+
+// channel offset this node listens on in the unicast slotframe
+uint16_t rx_channel_offset = 0;
+
+// channel offset the parent listens on: only this row of the cells can reach the parent
+uint16_t q_row = 0;
+
+#if QL_OCCUPANCY_SHARING
+// cells the neighbours reported busy in this and in the last send interval (two-hop view)
+uint8_t occupancy_current[QL_OCCUPANCY_BITMAP_SIZE];
+uint8_t occupancy_previous[QL_OCCUPANCY_BITMAP_SIZE];
+// cells this node sent in over the same intervals, the parent reports them busy but they are ours
+uint8_t own_tx_current[QL_OCCUPANCY_BITMAP_SIZE];
+uint8_t own_tx_previous[QL_OCCUPANCY_BITMAP_SIZE];
+#endif /* QL_OCCUPANCY_SHARING */
+
+#if QL_RX_PRUNING
+// slotframes since the last reception per timeslot, and the reception counters seen last
+uint16_t rx_idle_cycles[UNICAST_SLOTFRAME_LENGTH];
+uint16_t rx_frames_seen[UNICAST_SLOTFRAME_LENGTH];
+// timeslots whose Rx cell is pruned (bit ts % 8 of byte ts / 8)
+uint8_t rx_pruned[(UNICAST_SLOTFRAME_LENGTH + 7) / 8];
+#endif /* QL_RX_PRUNING */
+
+// reward function, maps the outcome of a Tx in a cell to a reward (can be swapped at runtime)
+ql_reward_function_t reward_function = QL_REWARD_FUNCTION;
 
 // cycles since the beginning of the first slotframe
-uint16_t cycles_since_start = 0;
+uint32_t cycles_since_start = 0;
 uint8_t schedule_setup = 0;
 
-// epsilon-greedy probability
-float epsilon_fixed = 0.5;
+#if QL_CHECKPOINT
+// learned (greedy) action, Q-values and time (clock_seconds) of the last checkpoint
+static uint16_t checkpoint_action;
+static q_value_t checkpoint_values[QL_NUM_ACTIONS];
+static unsigned long checkpoint_time;
+// 1 once there is a checkpoint of this run or one was restored
+static uint8_t checkpoint_written = 0;
+#endif /* QL_CHECKPOINT */
+
+#if QL_CONVERGENCE
+// 1 while the learning hibernates (converged): no TSCH lock and no selection, only failures are learned
+uint8_t hibernating = 0;
+// cells with the highest values (what the learner would pick without exploring), tracked for stability
+uint16_t greedy_actions[QL_MAX_TX_CELLS];
+uint8_t num_greedy_actions = 0;
+// Tx outcomes in the greedy cells over the current window
+uint16_t window_tx_ok = 0;
+uint16_t window_tx_failed = 0;
+// packets lost while hibernating over the current window
+uint16_t window_packets_lost = 0;
+#endif /* QL_CONVERGENCE */
 
-// Q-learning parameters
-float learning_rate = 0.1;
-float discount_factor = 0.95;
+// check if an action (or only its timeslot) is in a list of actions
+static uint8_t action_in_list(uint16_t action, const uint16_t *actions, uint8_t num, uint8_t timeslot_only)
+{
+  for (uint8_t i = 0; i < num; i++){
+    if (actions[i] == action ||
+        (timeslot_only && QL_ACTION_TIMESLOT(actions[i]) == QL_ACTION_TIMESLOT(action))){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#if QL_OCCUPANCY_SHARING
+// remember a cell this node sent in
+static void occupancy_own_tx(const struct tsch_ql_tx_outcome *outcome)
+{
+  uint16_t cell = QL_ACTION(outcome->timeslot, outcome->channel_offset);
+  own_tx_current[cell / 8] |= 1 << (cell % 8);
+}
+#endif /* QL_OCCUPANCY_SHARING */
+
+// receiver-based channel offset: every node listens on one offset derived from its address,
+// so children of different parents can share a timeslot without colliding
+static uint16_t get_rx_channel_offset(const linkaddr_t *addr)
+{
+  return addr->u8[LINKADDR_SIZE - 1] % QL_NUM_CHANNEL_OFFSETS;
+}
+
+#if QL_CONVERGENCE
+// go back to full learning and start a new convergence window
+static void resume_learning(const char *reason)
+{
+  if (hibernating){
+    LOG_INFO("Learning resumed: %s\n", reason);
+  }
+  hibernating = 0;
+  window_tx_ok = 0;
+  window_tx_failed = 0;
+  window_packets_lost = 0;
+}
+
+// count a Tx outcome towards the window if it was sent in a greedy cell (exploration draws do not count)
+static void count_convergence_outcome(const struct tsch_ql_tx_outcome *outcome)
+{
+  if (QL_LEARNED_OUTCOME(*outcome) &&
+      action_in_list(QL_ACTION(outcome->timeslot, outcome->channel_offset), greedy_actions, num_greedy_actions, 0)){
+    if (outcome->mac_tx_status == MAC_TX_OK){
+      window_tx_ok++;
+    } else {
+      window_tx_failed++;
+    }
+  }
+}
+
+// watch the greedy cells and their success rate over QL_CONVERGENCE_WINDOW Tx outcomes, returns 1
+// when the learning starts to hibernate (the greedy cells are then in greedy_actions)
+static uint8_t check_convergence(uint8_t num)
+{
+  q_value_t scores[UNICAST_SLOTFRAME_LENGTH];
+  uint16_t actions[QL_MAX_TX_CELLS];
+  uint8_t same;
+
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    scores[ts] = QL_LEARNER.value(QL_ACTION(ts, q_row));
+  }
+  // ties are broken at random, cells that are still tied do not look stable
+  num = ql_learner_pick_top(scores, q_row, actions, num);
+  same = (num == num_greedy_actions);
+  // the cells may come in any order
+  for (uint8_t i = 0; same && i < num; i++){
+    same = action_in_list(actions[i], greedy_actions, num_greedy_actions, 0);
+  }
+  if (!same){
+    // the greedy cells moved, start over
+    resume_learning("cells changed");
+    memcpy(greedy_actions, actions, num * sizeof(uint16_t));
+    num_greedy_actions = num;
+    return 0;
+  }
+
+  uint32_t total = (uint32_t)window_tx_ok + window_tx_failed;
+  if (total < QL_CONVERGENCE_WINDOW){
+    return 0;
+  }
+  if ((uint32_t)window_tx_ok * 100 >= QL_CONVERGENCE_SUCCESS_RATE * total){
+    hibernating = 1;
+    LOG_INFO("Learning converged on action %u (%u/%lu Tx ok), hibernating\n",
+             greedy_actions[0], window_tx_ok, (unsigned long)total);
+  }
+  window_tx_ok = 0;
+  window_tx_failed = 0;
+  return hibernating;
+}
+
+// converged slotframe: learn only from the failed Tx and wake up when packets get lost
+static void monitor_slotframe(void)
+{
+  struct ql_learner_context ctx;
+  struct tsch_ql_tx_outcome outcome;
+
+  ctx.row = q_row;
+  ctx.cycles = cycles_since_start;
+  ctx.busy_timeslots = NULL;
+  while (tsch_ql_get_tx_outcome(&outcome)){
+    if (!QL_LEARNED_OUTCOME(outcome)){
+      continue;
+    }
+#if QL_OCCUPANCY_SHARING
+    occupancy_own_tx(&outcome);
+#endif /* QL_OCCUPANCY_SHARING */
+    if (outcome.mac_tx_status != MAC_TX_OK){
+      QL_LEARNER.update(&ctx, QL_ACTION(outcome.timeslot, outcome.channel_offset), reward_function(&outcome));
+      window_tx_failed++;
+      if (outcome.last_tx){
+        window_packets_lost++;
+      }
+    } else {
+      window_tx_ok++;
+    }
+  }
+  tsch_ql_slotframe_summary_done();
+
+  if (window_packets_lost >= QL_CONVERGENCE_FAILURE_BURST){
+    resume_learning("failure burst");
+  } else if (wanted_tx_cells != num_tx_cells){
+    // the backlog needs more or less cells
+    resume_learning("backlog changed");
+  } else if ((uint32_t)window_tx_ok + window_tx_failed >= QL_CONVERGENCE_WINDOW){
+    window_tx_ok = 0;
+    window_tx_failed = 0;
+    window_packets_lost = 0;
+  }
+}
+#endif /* QL_CONVERGENCE */
+
+// switch to the Q-table of a parent, bind a free or the least recently used table if it has none
+static void select_q_table(const linkaddr_t *parent)
+{
+  struct q_table *t = NULL;
+  struct q_table *lru = &q_tables[0];
+
+  for (uint8_t i = 0; i < QL_NUM_Q_TABLES; i++){
+    if (linkaddr_cmp(&q_tables[i].parent, parent)){
+      t = &q_tables[i];
+      break;
+    }
+    if (q_tables[i].last_used < lru->last_used){
+      lru = &q_tables[i];
+    }
+  }
+
+  if (t == NULL){
+    if (linkaddr_cmp(&current_q_table->parent, &linkaddr_null)){
+      // the first parent keeps the state learned (or restored) so far
+      t = current_q_table;
+    } else {
+      // free tables have never been used, so they are the least recently used ones
+      t = lru;
+      t->state_len = 0;
+      LOG_INFO("New Q-table for parent ");
+      LOG_INFO_LLADDR(parent);
+      LOG_INFO_("\n");
+    }
+    linkaddr_copy(&t->parent, parent);
+  }
+
+  if (t != current_q_table){
+    // park the state of the old parent and load the one of the new parent
+    int len = QL_LEARNER.serialize(current_q_table->state, sizeof(current_q_table->state));
+    current_q_table->state_len = len > 0 ? len : 0;
+    if (t->state_len == 0 || !QL_LEARNER.deserialize(t->state, t->state_len)){
+      QL_LEARNER.init();
+    }
+#if QL_CONVERGENCE
+    // the cells learned for the old parent say nothing about the new one
+    resume_learning("parent changed");
+#endif /* QL_CONVERGENCE */
+  }
+
+  t->last_used = ++q_tables_clock;
+  current_q_table = t;
+  q_row = get_rx_channel_offset(parent);
+}
+
+// TSCH callback: the parent changed, switch to its Q-table
+void my_callback_new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if (new != NULL){
+    select_q_table(tsch_queue_get_nbr_address(new));
+  }
+}
+
+// follow the Q-table and the channel offset of the current parent (time source)
+static void update_q_row(void)
+{
+  struct tsch_neighbor *n = tsch_queue_get_time_source();
+  if (n != NULL){
+    // normally done by the new time source callback already
+    const linkaddr_t *addr = tsch_queue_get_nbr_address(n);
+    if (!linkaddr_cmp(addr, &current_q_table->parent)){
+      select_q_table(addr);
+    }
+  }
+}
+
+// grow or shrink the number of Tx cells with the backlog to the parent
+static void update_wanted_tx_cells(void)
+{
+  struct tsch_neighbor *n = tsch_queue_get_time_source();
+  int backlog;
+  if (n == NULL){
+    return;
+  }
+  backlog = tsch_queue_nbr_packet_count(n);
+  // with bursts, a Tx cell drains up to QL_BURST_MAX_LEN packets per slotframe
+  if (backlog > wanted_tx_cells * QL_BURST_MAX_LEN + QL_TX_CELLS_HYSTERESIS && wanted_tx_cells < QL_MAX_TX_CELLS){
+    wanted_tx_cells++;
+  } else if (backlog < (wanted_tx_cells - 1) * QL_BURST_MAX_LEN + 1 - QL_TX_CELLS_HYSTERESIS && wanted_tx_cells > 1){
+    wanted_tx_cells--;
+  }
+}
 
 // Set up the initial schedule
 static void init_tsch_schedule(void)
@@ -77,91 +480,226 @@ static void init_tsch_schedule(void)
   tsch_schedule_add_link(sf_broadcast, LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED,
                          LINK_TYPE_ADVERTISING, &tsch_broadcast_address, 0, 0, 0);
 
-  // create one Tx link in the fisrt slot of the unicast slotframe (if this is a simple node, otherwise it will be Rx link)
-  links_unicast_sf[0] = tsch_schedule_add_link(sf_unicast, LINK_OPTION_TX | LINK_OPTION_SHARED,
-                                                LINK_TYPE_NORMAL, &tsch_broadcast_address, 0, 0, 0);
+  // create one Tx link in the cell of the current action, the fisrt slot unless restored from a checkpoint
+  tx_actions[0] = current_action;
+  links_unicast_sf[QL_ACTION_TIMESLOT(current_action)] = tsch_schedule_add_link(sf_unicast, LINK_OPTION_TX | LINK_OPTION_SHARED,
+                                                LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                                                QL_ACTION_TIMESLOT(current_action), QL_ACTION_CHANNEL_OFFSET(current_action), 0);
 
-  // create multiple Rx links in the rest of the unicast slotframe
-  for (int i = 1; i < UNICAST_SLOTFRAME_LENGTH; i++)
+  // create multiple Rx links in the rest of the unicast slotframe, on our own channel offset
+  rx_channel_offset = get_rx_channel_offset(&linkaddr_node_addr);
+  for (int i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++)
   {
+    if (i == QL_ACTION_TIMESLOT(current_action)) continue;
     links_unicast_sf[i] = tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX | LINK_OPTION_SHARED,
-                                                 LINK_TYPE_NORMAL, &tsch_broadcast_address, i, 0, 0);
+                                                 LINK_TYPE_NORMAL, &tsch_broadcast_address, i, rx_channel_offset, 0);
   }
 }
 
-// set up new schedule based on the chosen action
-void set_up_new_schedule(uint8_t action)
-{ 
-  if (action != current_action)
-  {
-    links_unicast_sf[action] = tsch_schedule_add_link(sf_unicast, LINK_OPTION_TX | LINK_OPTION_SHARED,
-                                                      LINK_TYPE_NORMAL, &tsch_broadcast_address, action, 0, 1);
-    links_unicast_sf[current_action] = tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX | LINK_OPTION_SHARED,
-                                                              LINK_TYPE_NORMAL, &tsch_broadcast_address, current_action, 0, 1);
-    current_action = action;
+// cell changes collected by set_up_cell() and applied together by apply_cells() (at most one per timeslot)
+static struct tsch_link_update cell_updates[UNICAST_SLOTFRAME_LENGTH];
+static uint8_t num_cell_updates = 0;
+
+// turn the link of a timeslot into a Tx or an Rx cell in place, applied by apply_cells()
+static void set_up_cell(uint16_t timeslot, uint8_t link_options, uint16_t channel_offset)
+{
+  struct tsch_link_update *u;
+  if (links_unicast_sf[timeslot] == NULL){
+    // no link to change in place (adding one failed before): queue an add, the slot operation
+    // stores the new link in links_unicast_sf once it is applied
+    if (!tsch_schedule_enqueue_add_link(sf_unicast, link_options, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                                        timeslot, channel_offset, &links_unicast_sf[timeslot])){
+      LOG_WARN("no link in timeslot %u, adding one failed\n", timeslot);
+    }
+    return;
   }
+  u = &cell_updates[num_cell_updates++];
+  u->link = links_unicast_sf[timeslot];
+  u->link_options = link_options;
+  u->timeslot = timeslot;
+  u->channel_offset = channel_offset;
 }
 
-// function to populate the payload
-void create_payload()
+// apply the collected cell changes without stopping time-slotting
+static void apply_cells(void)
 {
-  for (uint16_t i = 4; i < UDP_PLAYLOAD_SIZE; i++)
-  {
-    custom_payload[i] = i + 'a';
+  uint8_t i;
+  // queued for the slot operation, what does not fit into the command ring is changed under one lock
+  for (i = 0; i < num_cell_updates; i++){
+    struct tsch_link_update *u = &cell_updates[i];
+    if (!tsch_schedule_enqueue_update_link(sf_unicast, u->link, u->link_options, u->timeslot, u->channel_offset)){
+      break;
+    }
   }
-  custom_payload[2] = 0xFF;
-  custom_payload[3] = 0xFF;
+  if (i < num_cell_updates && !tsch_schedule_update_links(sf_unicast, &cell_updates[i], num_cell_updates - i)){
+    LOG_WARN("%u cell changes could not be applied\n", num_cell_updates - i);
+  }
+  num_cell_updates = 0;
+}
+
+// set up new schedule based on the chosen actions (Tx cells)
+void set_up_new_schedule(const uint16_t *actions, uint8_t num)
+{ 
+  // turn the Tx cells whose timeslot is not used anymore back into Rx cells
+  for (uint8_t i = 0; i < num_tx_cells; i++){
+    if (!action_in_list(tx_actions[i], actions, num, 1)){
+      set_up_cell(QL_ACTION_TIMESLOT(tx_actions[i]), LINK_OPTION_RX | LINK_OPTION_SHARED, rx_channel_offset);
+    }
+  }
+
+  // install the new Tx cells (a kept timeslot may only move to another channel offset)
+  for (uint8_t i = 0; i < num; i++){
+    if (!action_in_list(actions[i], tx_actions, num_tx_cells, 0)){
+      set_up_cell(QL_ACTION_TIMESLOT(actions[i]), LINK_OPTION_TX | LINK_OPTION_SHARED,
+                  QL_ACTION_CHANNEL_OFFSET(actions[i]));
+    }
+  }
+  // the cells of a swap are changed together
+  apply_cells();
+
+  memcpy(tx_actions, actions, num * sizeof(uint16_t));
+  num_tx_cells = num;
+  current_action = actions[0];
 }
 
-// initialize q-values randomly or set all to 0
-void initialize_q_values(uint8_t val)
+#if QL_RX_PRUNING
+// keep listening in the Rx cells that received frames recently, let the others sleep outside of their probes.
+// The changes are queued to the slot operation, at most as many as the command ring still takes per
+// slotframe (the others wait for the next slotframes, starting from another timeslot every time)
+static void update_rx_cells(void)
 {
-  if (val){
-    for (uint8_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
-      q_values[i] = (float) random_rand()/RANDOM_RAND_MAX;
+  int space = tsch_schedule_enqueue_space();
+
+  for (uint16_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+    uint16_t ts = (cycles_since_start + i) % UNICAST_SLOTFRAME_LENGTH;
+    uint16_t frames = get_apt_rx_frames(ts);
+    uint8_t prune;
+
+    if (frames != rx_frames_seen[ts]){
+      rx_frames_seen[ts] = frames;
+      rx_idle_cycles[ts] = 0;
+    } else if (rx_idle_cycles[ts] < 0xffff){
+      rx_idle_cycles[ts]++;
     }
-  } else {
-    for (uint8_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
-      q_values[i] = 0;
+
+    // the Tx cells are left to set_up_new_schedule, a released Tx cell comes back as an Rx cell
+    if (action_in_list(QL_ACTION(ts, 0), tx_actions, num_tx_cells, 1)){
+      rx_pruned[ts / 8] &= ~(1 << (ts % 8));
+      continue;
+    }
+
+    prune = rx_idle_cycles[ts] >= QL_RX_PRUNING_IDLE_CYCLES &&
+            (cycles_since_start + ts) % QL_RX_PRUNING_PROBE_INTERVAL >= QL_RX_PRUNING_PROBE_LEN;
+    if (prune != ((rx_pruned[ts / 8] >> (ts % 8)) & 1) && space > 0){
+      space--;
+      // a pruned cell keeps its link without options, the slot operation leaves the radio off
+      set_up_cell(ts, prune ? 0 : LINK_OPTION_RX | LINK_OPTION_SHARED, rx_channel_offset);
+      rx_pruned[ts / 8] ^= 1 << (ts % 8);
     }
   }
+  apply_cells();
 }
+#endif /* QL_RX_PRUNING */
 
-// choose exploration/explotation ==> 1/0 (gradient-greedy function)
-uint8_t policy_check()
-{ 
-  float num = (float) random_rand()/RANDOM_RAND_MAX;
-  float epsilon_new = (10000.0 / (float)cycles_since_start);
-  if (epsilon_new > epsilon_fixed) epsilon_new = epsilon_fixed;
-  
-  if (num < epsilon_new)
-      return 1;
-  else
-      return 0;  
+#if QL_OCCUPANCY_SHARING
+// merge the occupancy bitmap of a neighbour into the two-hop view
+static void occupancy_rx_packet(struct simple_udp_connection *c, const uip_ipaddr_t *sender_addr,
+                                uint16_t sender_port, const uip_ipaddr_t *receiver_addr,
+                                uint16_t receiver_port, const uint8_t *data, uint16_t datalen)
+{
+  // the first two bytes are the number of cells, a different layout is ignored
+  if (datalen != 2 + QL_OCCUPANCY_BITMAP_SIZE || (data[0] | (data[1] << 8)) != QL_NUM_ACTIONS){
+    return;
+  }
+  for (uint16_t i = 0; i < QL_OCCUPANCY_BITMAP_SIZE; i++){
+    occupancy_current[i] |= data[2 + i];
+  }
 }
 
-// function to find the highest Q-value and return its index
-uint8_t max_q_value_index()
+// broadcast the cells this node heard busy (APT) or transmits in, then age the two-hop view
+static void send_occupancy_bitmap(struct simple_udp_connection *c)
 {
-  uint8_t max = random_rand()%UNICAST_SLOTFRAME_LENGTH;
-  for (uint8_t i = 1; i < UNICAST_SLOTFRAME_LENGTH; i++)
-  {
-    if (q_values[i] > q_values[max])
-    {
-      max = i;
+  uint8_t msg[2 + QL_OCCUPANCY_BITMAP_SIZE];
+  uint8_t *table = get_apt_table();
+  uip_ipaddr_t dst;
+
+  memset(msg, 0, sizeof(msg));
+  msg[0] = QL_NUM_ACTIONS & 0xFF;
+  msg[1] = (QL_NUM_ACTIONS >> 8) & 0xFF;
+  for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
+    if (table[i] >= QL_OCCUPANCY_BUSY_TABLE || action_in_list(i, tx_actions, num_tx_cells, 0)){
+      msg[2 + i / 8] |= 1 << (i % 8);
     }
   }
-  return max;
+  uip_create_linklocal_allnodes_mcast(&dst);
+  simple_udp_sendto(c, msg, sizeof(msg), &dst);
+
+  memcpy(occupancy_previous, occupancy_current, QL_OCCUPANCY_BITMAP_SIZE);
+  memset(occupancy_current, 0, QL_OCCUPANCY_BITMAP_SIZE);
+  memcpy(own_tx_previous, own_tx_current, QL_OCCUPANCY_BITMAP_SIZE);
+  memset(own_tx_current, 0, QL_OCCUPANCY_BITMAP_SIZE);
 }
 
-// Update q-value table function
-void update_q_table(uint8_t action, int reward)
-{ 
-  uint8_t max = max_q_value_index();
-  float expected_max_q_value = q_values[max] + reward_succes;
-  q_values[action] = (1 - learning_rate) * q_values[action] + 
-                      learning_rate * (reward + discount_factor * expected_max_q_value -
-                      q_values[action]);
+
+// timeslots whose cell on the parent's channel offset is busy two hops away (our own current and
+// recent Tx cells excluded),
+// the bitmaps are only written in process context (rx_packet and send_occupancy_bitmap, which reads
+// the APT through the get_apt_table() copy)
+static void get_busy_timeslots(uint8_t *busy)
+{
+  memset(busy, 0, (UNICAST_SLOTFRAME_LENGTH + 7) / 8);
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    uint16_t cell = QL_ACTION(ts, q_row);
+    uint8_t own = (own_tx_current[cell / 8] | own_tx_previous[cell / 8]) & (1 << (cell % 8));
+    if (((occupancy_current[cell / 8] | occupancy_previous[cell / 8]) & (1 << (cell % 8))) && !own &&
+        !action_in_list(cell, tx_actions, num_tx_cells, 1)){
+      busy[ts / 8] |= 1 << (ts % 8);
+    }
+  }
+}
+#endif /* QL_OCCUPANCY_SHARING */
+
+// sum the skipped slots up per cause and per slotframe, the locked wake-ups are only known in total
+static void get_skipped_slots(uint32_t *counters)
+{
+  memset(counters, 0, QL_SKIPPED_SLOTS_COUNTERS * sizeof(uint32_t));
+  counters[TSCH_QL_SKIP_LOCKED] = tsch_ql_get_skipped_slots(TSCH_QL_SKIP_LOCKED, 0);
+  for (uint8_t cause = TSCH_QL_SKIP_LOCKED + 1; cause < TSCH_QL_SKIP_NUM; cause++){
+    for (uint16_t handle = 0; handle <= TSCH_QL_SKIP_OTHER_HANDLE; handle++){
+      uint32_t count = tsch_ql_get_skipped_slots(cause, handle);
+      counters[cause] += count;
+      counters[TSCH_QL_SKIP_NUM + handle] += count;
+    }
+  }
+}
+
+// print the skipped slot counters after a log prefix
+static void log_skipped_slots(const uint32_t *counters)
+{
+  LOG_INFO_(" locked %lu lock-requested %lu no-link %lu timer-miss %lu slotframes:",
+            (unsigned long)counters[TSCH_QL_SKIP_LOCKED], (unsigned long)counters[TSCH_QL_SKIP_LOCK_REQUESTED],
+            (unsigned long)counters[TSCH_QL_SKIP_NO_LINK], (unsigned long)counters[TSCH_QL_SKIP_TIMER_MISS]);
+  for (uint16_t i = TSCH_QL_SKIP_NUM; i < QL_SKIPPED_SLOTS_COUNTERS; i++){
+    LOG_INFO_(" %lu", (unsigned long)counters[i]);
+  }
+  LOG_INFO_("\n");
+}
+
+// radio-on time in ms, for the logs
+static unsigned long radio_on_ms(uint32_t ticks)
+{
+  return (unsigned long)((uint64_t)ticks * 1000 / RTIMER_SECOND);
+}
+
+// function to populate the payload
+void create_payload()
+{
+  for (uint16_t i = 4; i < UDP_PLAYLOAD_SIZE; i++)
+  {
+    custom_payload[i] = i + 'a';
+  }
+  custom_payload[2] = 0xFF;
+  custom_payload[3] = 0xFF;
 }
 
 // link selector function
@@ -169,15 +707,21 @@ int my_callback_packet_ready(void)
 {
 #if TSCH_CONF_WITH_LINK_SELECTOR
   uint8_t slotframe = 0;
-  uint8_t channel_offset = 0;
-  uint8_t timeslot = 0;
+  uint16_t channel_offset = 0;
+  uint16_t timeslot = 0;
 
   char *ch = packetbuf_dataptr();
   uint8_t f0 = ch[0] & 0xFF, f1 = ch[1] & 0xFF, f2 = ch[2] & 0xFF, f3 = ch[3] & 0xFF;
   // LOG_INFO("Values: ch[0]: %d ch[1]: %d  ch[2]: %d  ch[3]: %d\n", ch[0] & 0xFF, ch[1] & 0xFF, ch[2] & 0xFF, ch[3] & 0xFF);
   if (f0 == 126 && f1 == 247 && f2 == 0 && f3 == 225)
   {
-    timeslot = current_action;
+    if (num_tx_cells == 1){
+      timeslot = QL_ACTION_TIMESLOT(current_action);
+      channel_offset = QL_ACTION_CHANNEL_OFFSET(current_action);
+    } else { /* any of the Tx cells */
+      timeslot = 0xffff;
+      channel_offset = 0xffff;
+    }
     slotframe = 1;
     // LOG_INFO("Current Packet is a UDP packet\n");
   }
@@ -193,6 +737,54 @@ int my_callback_packet_ready(void)
   return 1;
 }
 
+#if QL_CHECKPOINT
+// cell with the highest value in the row of the parent (the first one on ties), unlike current_action
+// it does not follow the exploration draws
+static uint16_t checkpoint_greedy_action(void)
+{
+  uint16_t best = QL_ACTION(0, q_row);
+  for (uint16_t ts = 1; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    if (QL_LEARNER.value(QL_ACTION(ts, q_row)) > QL_LEARNER.value(best)){
+      best = QL_ACTION(ts, q_row);
+    }
+  }
+  return best;
+}
+
+// remember the learned action and Q-values of the last checkpoint
+static void checkpoint_reference(void)
+{
+  checkpoint_action = checkpoint_greedy_action();
+  for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
+    checkpoint_values[i] = QL_LEARNER.value(i);
+  }
+  checkpoint_time = clock_seconds();
+}
+
+// 1 if the learned state changed enough since the last checkpoint to be worth a flash write
+static uint8_t checkpoint_changed(void)
+{
+  if (checkpoint_greedy_action() != checkpoint_action) return 1;
+  for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
+    q_value_t diff = QL_LEARNER.value(i) - checkpoint_values[i];
+    if (Q_ABS(diff) > QL_CHECKPOINT_MIN_CHANGE) return 1;
+  }
+  return 0;
+}
+
+// 1 if it is time for a checkpoint: the first one as soon as the learning converged (so that an early
+// reset does not lose it), then at most every QL_CHECKPOINT_MIN_INTERVAL minutes
+static uint8_t checkpoint_due(void)
+{
+#if QL_CONVERGENCE
+  if (!checkpoint_written){
+    return hibernating;
+  }
+#endif /* QL_CONVERGENCE */
+  return clock_seconds() - checkpoint_time >= QL_CHECKPOINT_MIN_INTERVAL * 60UL;
+}
+#endif /* QL_CHECKPOINT */
+
 // function to receive udp packets
 static void rx_packet(struct simple_udp_connection *c, const uip_ipaddr_t *sender_addr,
                       uint16_t sender_port, const uip_ipaddr_t *receiver_addr,
@@ -206,6 +798,18 @@ static void rx_packet(struct simple_udp_connection *c, const uip_ipaddr_t *sende
   packet_num = (packet_num << 8) + (received_data[0] & 0xFF);
 
   LOG_INFO("Received_from %d packet_number: %d\n", sender_addr->u8[15], packet_num);
+#if QL_SKIPPED_SLOTS_REPORT
+  // the counters of the sender, 16 bits wrapping
+  if (datalen >= QL_SKIPPED_SLOTS_REPORT_OFFSET + 2 * QL_SKIPPED_SLOTS_COUNTERS){
+    uint32_t counters[QL_SKIPPED_SLOTS_COUNTERS];
+    for (uint16_t i = 0; i < QL_SKIPPED_SLOTS_COUNTERS; i++){
+      const uint8_t *counter = data + QL_SKIPPED_SLOTS_REPORT_OFFSET + 2 * i;
+      counters[i] = counter[0] | (counter[1] << 8);
+    }
+    LOG_INFO("Skipped_from %d:", sender_addr->u8[15]);
+    log_skipped_slots(counters);
+  }
+#endif /* QL_SKIPPED_SLOTS_REPORT */
   // LOG_INFO_6ADDR(sender_addr);
   // LOG_INFO_("node: %d\n", sender_addr->u8[15]);
   // LOG_INFO_("  data: %s\n", data);
@@ -215,10 +819,14 @@ static void rx_packet(struct simple_udp_connection *c, const uip_ipaddr_t *sende
 PROCESS_THREAD(node_udp_process, ev, data)
 {
   static struct simple_udp_connection udp_conn;
+#if QL_OCCUPANCY_SHARING
+  static struct simple_udp_connection occupancy_conn;
+#endif /* QL_OCCUPANCY_SHARING */
   static struct etimer periodic_timer;
 
   static uint16_t seqnum;
   uip_ipaddr_t dst;
+  uint32_t skipped[QL_SKIPPED_SLOTS_COUNTERS];
 
   PROCESS_BEGIN();
 
@@ -226,8 +834,28 @@ PROCESS_THREAD(node_udp_process, ev, data)
   reset_apt_table();
   // creating the payload
   create_payload();
-  // initialize q-values
-  initialize_q_values(0);
+  // initialize the learner (q-values)
+  QL_LEARNER.init();
+  LOG_INFO("Learner: %s\n", QL_LEARNER.name);
+#if QL_CHECKPOINT
+  // warm start from the learned state of the last run, if it matches this configuration and learner
+  {
+    uint32_t cycles;
+    uint16_t action;
+    uint16_t len = ql_checkpoint_restore(current_q_table->state, sizeof(current_q_table->state),
+                                         &cycles, &action);
+    if (len > 0 && QL_LEARNER.deserialize(current_q_table->state, len)){
+      cycles_since_start = cycles;
+      current_action = action;
+      checkpoint_written = 1;
+    } else {
+      // no usable checkpoint (stale, corrupted or of another learner), do not read it again at the next boot
+      ql_checkpoint_remove();
+    }
+    // the restored (or initial) state is the reference for the next checkpoint
+    checkpoint_reference();
+  }
+#endif /* QL_CHECKPOINT */
   // set up the initial schedule
   init_tsch_schedule();
   
@@ -238,6 +866,9 @@ PROCESS_THREAD(node_udp_process, ev, data)
 
   /* Initialization; `rx_packet` is the function for packet reception */
   simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, rx_packet);
+#if QL_OCCUPANCY_SHARING
+  simple_udp_register(&occupancy_conn, QL_OCCUPANCY_PORT, NULL, QL_OCCUPANCY_PORT, occupancy_rx_packet);
+#endif /* QL_OCCUPANCY_SHARING */
 
   if (node_id == 1)
   { /* node_id is 1, then start as root*/
@@ -248,6 +879,7 @@ PROCESS_THREAD(node_udp_process, ev, data)
 
   // start QL-TSCH protocol
   schedule_setup = 1;
+  process_poll(&scheduler_process);
 
   // if this is a simple node, start sending upd packets
   LOG_INFO("Started UDP communication\n");
@@ -260,24 +892,50 @@ PROCESS_THREAD(node_udp_process, ev, data)
   {
     // print the Q-values
     LOG_INFO("Q-Values:");
-    for (uint8_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
-      LOG_INFO_(" %u-> %f", i, q_values[i]);
+    for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
+      LOG_INFO_(" %u-> " Q_PRINTF_FMT, i, Q_PRINTF_ARGS(QL_LEARNER.value(i)));
     }
     LOG_INFO_("\n");
 
     // print APT table values
     LOG_INFO("APT-Values:");
     uint8_t *table = get_apt_table();
-    for (uint8_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+    for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
       LOG_INFO_(" (%u->%u)", i, table[i]);
     }
     LOG_INFO_("\n");
-    LOG_INFO("Total frame cycles: %u\n", cycles_since_start);
+    // print the undecodable transmissions heard in the Rx cells
+    uint32_t rx_energy = 0, rx_crc_failures = 0;
+    for (uint16_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+      rx_energy += get_apt_rx_noise(i)->energy;
+      rx_crc_failures += get_apt_rx_noise(i)->crc_failures;
+    }
+    LOG_INFO("Rx-Noise: energy %lu crc %lu\n", (unsigned long)rx_energy, (unsigned long)rx_crc_failures);
+    // print the slots the slot operation skipped (lock, no link, missed wake-up)
+    get_skipped_slots(skipped);
+    LOG_INFO("Skipped-Slots:");
+    log_skipped_slots(skipped);
+    // print the radio-on time of the unicast cells (ms), the link types and in total
+    LOG_INFO("Radio-On:");
+    for (uint16_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+      LOG_INFO_(" (%u->%lu)", i, radio_on_ms(tsch_ql_get_radio_on_cell(1, i)));
+    }
+    LOG_INFO_(" normal %lu advertising %lu total %lu\n",
+              radio_on_ms(tsch_ql_get_radio_on_link_type(LINK_TYPE_NORMAL)),
+              radio_on_ms(tsch_ql_get_radio_on_link_type(LINK_TYPE_ADVERTISING)),
+              radio_on_ms(tsch_ql_get_radio_on_total()));
+#if QL_SLOT_PROFILE
+    // print how long the phases of the slot operation take
+    tsch_ql_profile_log();
+#endif /* QL_SLOT_PROFILE */
+    LOG_INFO("Total frame cycles: %lu\n", (unsigned long)cycles_since_start);
 
     // reset all the backoff windows for all the neighbours
     // custom_reset_all_backoff_exponents();
-    // reset APT-table values
-    reset_apt_table();
+#if QL_OCCUPANCY_SHARING
+    // share the cells used recently (the APT table decays by itself every QL_APT_DECAY_PERIOD slotframes)
+    send_occupancy_bitmap(&occupancy_conn);
+#endif /* QL_OCCUPANCY_SHARING */
 
     PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
 
@@ -287,6 +945,15 @@ PROCESS_THREAD(node_udp_process, ev, data)
         /* Send the packet number to the root and extra data */
         custom_payload[0] = seqnum & 0xFF;
         custom_payload[1] = (seqnum >> 8) & 0xFF;
+#if QL_SKIPPED_SLOTS_REPORT
+        // the current counters, 16 bits wrapping (the root keeps the history)
+        get_skipped_slots(skipped);
+        for (uint16_t i = 0; i < QL_SKIPPED_SLOTS_COUNTERS &&
+             QL_SKIPPED_SLOTS_REPORT_OFFSET + 2 * i + 1 < UDP_PLAYLOAD_SIZE; i++){
+          custom_payload[QL_SKIPPED_SLOTS_REPORT_OFFSET + 2 * i] = skipped[i] & 0xFF;
+          custom_payload[QL_SKIPPED_SLOTS_REPORT_OFFSET + 2 * i + 1] = (skipped[i] >> 8) & 0xFF;
+        }
+#endif /* QL_SKIPPED_SLOTS_REPORT */
         LOG_INFO("Sent_to %d packet_number: %d\n", dst.u8[15], seqnum);
         // LOG_INFO_6ADDR(&dst);
         // LOG_INFO_(" packet_number: %d\n", seqnum);
@@ -300,56 +967,117 @@ PROCESS_THREAD(node_udp_process, ev, data)
 }
 /********** UDP Communication Process - End ***********/
 
+// count the slotframe and store the learned state when it changed, at most every few minutes
+static void end_slotframe(void)
+{
+  cycles_since_start++;
+
+#if QL_CHECKPOINT
+  if (cycles_since_start % QL_CHECKPOINT_INTERVAL == 0 && checkpoint_due() && checkpoint_changed()){
+    int len = QL_LEARNER.serialize(current_q_table->state, sizeof(current_q_table->state));
+    // the learned cell is restored, not the last exploration draw
+    if (len > 0 && ql_checkpoint_save(current_q_table->state, len, cycles_since_start,
+                                      checkpoint_greedy_action())){
+      checkpoint_reference();
+      checkpoint_written = 1;
+    }
+  }
+#endif /* QL_CHECKPOINT */
+}
+
 /********** QL-TSCH Scheduler Process - Start ***********/
 PROCESS_THREAD(scheduler_process, ev, data)
 {
-  // timer to update the policy
-  static struct etimer policy_update_timer;
-  
+  // Tx outcomes of the last unicast slotframe
+  static struct tsch_ql_slotframe_summary *summary;
+
   PROCESS_BEGIN();
   
   // wait untill the initial setupt finishes
-  while(1) if(schedule_setup) break;
-  LOG_INFO("Finished Setting up cycles: %u\n", cycles_since_start);
+  PROCESS_WAIT_EVENT_UNTIL(schedule_setup);
+  LOG_INFO("Finished Setting up cycles: %lu\n", (unsigned long)cycles_since_start);
   
-  // set the timer for one whole frame cycle 
-  etimer_set(&policy_update_timer, UPDATE_POLICY_INTERVAL);
+  // update the policy once at every boundary of the unicast slotframe
+  tsch_ql_register_slotframe_process(&scheduler_process, 1);
 
   /* Main Scheduler Loop */
   while (1)
   { 
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&policy_update_timer));
+    PROCESS_WAIT_EVENT_UNTIL(ev == tsch_ql_slotframe_event);
+    summary = (struct tsch_ql_slotframe_summary *)data;
+
+    // the neighbour table can only be read before taking the TSCH lock
+    update_q_row();
+    update_wanted_tx_cells();
+
+#if QL_CONVERGENCE
+    if (hibernating){
+      // converged: leave time-slotting alone and keep the Tx cells
+      monitor_slotframe();
+#if QL_RX_PRUNING
+      update_rx_cells();
+#endif /* QL_RX_PRUNING */
+      end_slotframe();
+      continue;
+    }
+#endif /* QL_CONVERGENCE */
 
 #if WITH_TSCH_LOCKING
-    // lock time-slotting before starting the first schedule
-    while(1) if (tsch_get_lock() == 1) break;
-    // tsch_get_lock();
+    // lock time-slotting while reading the tables, this only waits for the ongoing slot to end
+    if (!tsch_get_lock()){
+      tsch_ql_slotframe_summary_done();
+      continue;
+    }
     // LOG_INFO("TSCH got locked -> WARNING !!!\n");
 #endif /* WITH_TSCH_LOCKING */
 
     /**********  Q-value update calculations - Start **********/
+
+    // what the learner knows about the node
+    struct ql_learner_context ctx;
+#if QL_OCCUPANCY_SHARING
+    uint8_t busy_timeslots[(UNICAST_SLOTFRAME_LENGTH + 7) / 8];
+    get_busy_timeslots(busy_timeslots);
+    ctx.busy_timeslots = busy_timeslots;
+#else
+    ctx.busy_timeslots = NULL;
+#endif /* QL_OCCUPANCY_SHARING */
+    ctx.row = q_row;
+    ctx.cycles = cycles_since_start;
     
-    // updating the q-table based on the last action results
-    uint8_t transmission_status = get_and_reset_Tx_slot_status();
-    if (transmission_status){
-      if (transmission_status == 1){
-        update_q_table(current_action, reward_succes);
-      } else {
-        update_q_table(current_action, reward_failure);
+    // updating the q-table with every transmission in a learned cell since the last update (retries included)
+    struct tsch_ql_tx_outcome outcome;
+    while (tsch_ql_get_tx_outcome(&outcome)){
+      if (QL_LEARNED_OUTCOME(outcome)){
+        QL_LEARNER.update(&ctx, QL_ACTION(outcome.timeslot, outcome.channel_offset), reward_function(&outcome));
+#if QL_OCCUPANCY_SHARING
+        occupancy_own_tx(&outcome);
+#endif /* QL_OCCUPANCY_SHARING */
+        // LOG_INFO("Updating the Q-table\n");
       }
-      // LOG_INFO("Updating the Q-table\n");
+#if QL_CONVERGENCE
+      count_convergence_outcome(&outcome);
+#endif /* QL_CONVERGENCE */
+      // LOG_INFO("Transmission status: %u\n", outcome.status);
+    }
+    // the adaptive exploration follows the Tx success rate
+    ql_exploration_feedback(summary->tx_ok, summary->tx_failed);
+    if (summary->tx_dropped){
+      LOG_WARN("%u Tx outcomes dropped, ring is full\n", summary->tx_dropped);
     }
-    // LOG_INFO("Transmission status: %u\n", transmission_status);
+    tsch_ql_slotframe_summary_done();
     
-    // choosing exploration/exploatation and updating the schedule
-    uint8_t action;
-    if (policy_check() == 1){ /* Exploration */
-      action = get_slot_with_apt_table_min_value();
-      // LOG_INFO("Exploartion is selected. Action is %u\n", action);
-    } else { /* Explotation */
-      action = max_q_value_index();
-      // LOG_INFO("Explotation is selected. Action is %u\n", action);
+    // choosing the Tx cells (exploration/exploatation is up to the learner) and updating the schedule
+    uint16_t actions[QL_MAX_TX_CELLS];
+    uint8_t num_actions = QL_LEARNER.select(&ctx, actions, wanted_tx_cells);
+    // LOG_INFO("Action is %u\n", actions[0]);
+#if QL_CONVERGENCE
+    if (check_convergence(wanted_tx_cells)){
+      // hibernate in the greedy cells, not in what exploration drew this time
+      memcpy(actions, greedy_actions, num_greedy_actions * sizeof(uint16_t));
+      num_actions = num_greedy_actions;
     }
+#endif /* QL_CONVERGENCE */
 
 #if WITH_TSCH_LOCKING
     // start the slot operations again and set the timer
@@ -358,14 +1086,13 @@ PROCESS_THREAD(scheduler_process, ev, data)
 #endif /* WITH_TSCH_LOCKING */
 
     // set up a new schedule after releasing the TSCH lock
-    set_up_new_schedule(action);
-
-    // set the timer again -> duration = (unicast + broadcast) slotframe cycle
-    while (1) if (!tsch_is_locked()) break;
-    etimer_set(&policy_update_timer, UPDATE_POLICY_INTERVAL);
+    set_up_new_schedule(actions, num_actions);
+#if QL_RX_PRUNING
+    // then sleep in the Rx cells nobody sends in
+    update_rx_cells();
+#endif /* QL_RX_PRUNING */
 
-    current_action = action;
-    cycles_since_start++;
+    end_slotframe();
 
     /**********  Q-value update calculations - End **********/
 
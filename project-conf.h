@@ -46,19 +46,75 @@
 // define a link selector function
 #define TSCH_CONF_WITH_LINK_SELECTOR 0
 #define TSCH_CALLBACK_PACKET_READY my_callback_packet_ready
+// switch Q-tables when the parent (time source) changes
+#define TSCH_CALLBACK_NEW_TIME_SOURCE my_callback_new_time_source
 
 // macros to enbale QL-TSCH in tsch libriaries
 #define QL_TSCH_ENABLED_CONF 1
 
-// Run algorithm with tsch locking
-#define WITH_TSCH_LOCKING 1
+// use Q16.16 fixed-point arithmetic for the Q-learning instead of float (no FPU)
+#define QL_FIXED_POINT_CONF 1
 
-// drift compensation time when tsch locking is used in milliseconds
-#define EXTRA_TIME 78
+// number of channel offsets in the QL-TSCH action space (at most the hopping sequence length)
+#define QL_NUM_CHANNEL_OFFSETS_CONF 2
 
-// define an interval policy update time, for testing (fixed time to update Q-table)
-// not et the beginning of each slotframe
-#define UPDATE_POLICY_INTERVAL_CONF 0
+// Maximum number of Tx cells a node takes to drain its queue
+#define QL_MAX_TX_CELLS_CONF 3
+
+// Save the Q-table to CFS once the learning converged, then when the learned action or the Q-values
+// changed at most every 30 minutes (alternating between two files), and restore it after a reboot
+#define QL_CHECKPOINT_CONF 1
+#define QL_CHECKPOINT_INTERVAL_CONF 100
+#define QL_CHECKPOINT_MIN_INTERVAL_CONF 30
+
+// Share a cell occupancy bitmap with the neighbours (two-hop view for exploration)
+#define QL_OCCUPANCY_SHARING_CONF 1
+
+// Keep a Q-table for up to 3 parents
+#define QL_NUM_Q_TABLES_CONF 3
+
+// Reward retransmissions, queueing delay and ACK quality, not only success
+// (ql_reward_energy also charges the radio-on time of each Tx)
+#define QL_REWARD_FUNCTION_CONF ql_reward_latency
+
+// Account the radio-on time of the cells with Energest (listen and transmit time) instead of the rtimer
+#define ENERGEST_CONF_ON 1
+
+// Learner choosing the Tx cells: ql_learner_ql_tsch, ql_learner_ucb1, ql_learner_softmax or ql_learner_thompson
+#define QL_LEARNER_CONF ql_learner_ql_tsch
+
+// Exploration schedule of QL-TSCH: ql_exploration_inverse_time (10000 / cycles), ql_exploration_exponential,
+// ql_exploration_linear or ql_exploration_adaptive (follows the Tx success rate)
+#define QL_EXPLORATION_SCHEDULE_CONF ql_exploration_inverse_time
+
+// Explore a timeslot drawn by inverse occupancy (alias sampler) rather than always the least occupied one
+#define QL_EXPLORATION_WEIGHTED_CONF 1
+
+// Stop learning once the greedy Tx cells are stable and successful, resume on a failure burst or a parent change
+#define QL_CONVERGENCE_CONF 1
+
+// Precompile the schedule over the hyperperiod (7 x 15 = 105 slots) for an O(1) next link lookup
+#define QL_SCHEDULE_CALENDAR_CONF 1
+
+// Send the skipped slot counters to the root in the data packets
+#define QL_SKIPPED_SLOTS_REPORT_CONF 1
+
+// Send up to 4 queued packets back to back (frame pending bursts) from a learned Tx cell
+#define QL_BURST_MAX_LEN_CONF 4
+
+// Turn off the Rx cells that received nothing for 512 slotframes, probing each one
+// for 8 slotframes out of 64 to find new children
+#define QL_RX_PRUNING_CONF 1
+
+// Time the phases of the slot operation into histograms, printed with the Q-values (costs a few timer reads per slot)
+#define QL_SLOT_PROFILE_CONF 0
+
+// Age the APT once per packet sending interval (10 ms timeslots) instead of every slotframe
+#define QL_APT_DECAY_PERIOD_CONF ((PACKET_SENDING_INTERVAL * 100UL) / UNICAST_SLOTFRAME_LENGTH)
+
+// Run algorithm with tsch locking (not needed anymore: schedule changes are queued to the slot operation,
+// and the APT readers copy the cells of a timeslot in a short critical section)
+#define WITH_TSCH_LOCKING 0
 
 // Default slotframe length
 // #define TSCH_SCHEDULE_CONF_DEFAULT_LENGTH 7
@@ -0,0 +1,159 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+
+#include "ql-checkpoint.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "QL-CKPT"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+/********** Checkpoint format ***********/
+
+// "QL" and the layout version, bump the version whenever the layout changes
+#define QL_CHECKPOINT_MAGIC 0x514c
+#define QL_CHECKPOINT_VERSION 4
+
+// the file is this header followed by the serialized learner state (which tags its learner)
+struct ql_checkpoint_header {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t fixed_point;            // a float table cannot be read as Q16.16 and the other way round
+  uint16_t slotframe_length;      // the Q-table only fits the same unicast slotframe length
+  uint16_t num_channel_offsets;   // ... and the same number of channel offsets
+  uint32_t sequence;              // the newer of the two files has the higher sequence number
+  uint32_t cycles_since_start;
+  uint16_t current_action;
+  uint16_t state_len;
+  uint16_t crc;                   // over the state
+};
+
+// the checkpoints alternate between two files, a power loss while one is rewritten leaves the other
+static const char *const checkpoint_files[2] = { QL_CHECKPOINT_FILE ".0", QL_CHECKPOINT_FILE ".1" };
+
+// file of the newest valid checkpoint (the next one goes to the other file) and its sequence number
+static uint8_t checkpoint_slot = 1;
+static uint32_t checkpoint_sequence = 0;
+
+/********** Functions ***********/
+
+// write the learned state to the older of the two checkpoint files
+int ql_checkpoint_save(const uint8_t *state, uint16_t state_len, uint32_t cycles_since_start,
+                       uint16_t current_action)
+{
+  struct ql_checkpoint_header header;
+  uint8_t slot = checkpoint_slot ^ 1;
+  int fd;
+  int ok;
+
+  header.magic = QL_CHECKPOINT_MAGIC;
+  header.version = QL_CHECKPOINT_VERSION;
+  header.fixed_point = QL_FIXED_POINT;
+  header.slotframe_length = UNICAST_SLOTFRAME_LENGTH;
+  header.num_channel_offsets = QL_NUM_CHANNEL_OFFSETS;
+  header.sequence = checkpoint_sequence + 1;
+  header.cycles_since_start = cycles_since_start;
+  header.current_action = current_action;
+  header.state_len = state_len;
+  header.crc = crc16_data(state, state_len, 0);
+
+  // a partly written file is caught by the crc on restore, the newest checkpoint is in the other file
+  cfs_remove(checkpoint_files[slot]);
+  fd = cfs_open(checkpoint_files[slot], CFS_WRITE);
+  if (fd < 0){
+    LOG_ERR("could not open %s for writing\n", checkpoint_files[slot]);
+    return 0;
+  }
+  ok = cfs_write(fd, &header, sizeof(header)) == sizeof(header) &&
+       cfs_write(fd, state, state_len) == state_len;
+  cfs_close(fd);
+
+  if (!ok){
+    LOG_ERR("could not write %s\n", checkpoint_files[slot]);
+    return 0;
+  }
+  checkpoint_slot = slot;
+  checkpoint_sequence = header.sequence;
+  return 1;
+}
+
+// read the header of a checkpoint file, returns 1 if it was written for this configuration
+static int read_header(uint8_t slot, struct ql_checkpoint_header *header, uint16_t max_len)
+{
+  int fd = cfs_open(checkpoint_files[slot], CFS_READ);
+  int ok;
+
+  if (fd < 0){
+    return 0;
+  }
+  ok = cfs_read(fd, header, sizeof(*header)) == sizeof(*header);
+  cfs_close(fd);
+  return ok && header->magic == QL_CHECKPOINT_MAGIC && header->version == QL_CHECKPOINT_VERSION &&
+         header->fixed_point == QL_FIXED_POINT &&
+         header->slotframe_length == UNICAST_SLOTFRAME_LENGTH &&
+         header->num_channel_offsets == QL_NUM_CHANNEL_OFFSETS &&
+         header->current_action < QL_NUM_ACTIONS && header->state_len <= max_len;
+}
+
+// read the state of a checkpoint file whose header is valid, returns 1 if it is not corrupted
+static int read_state(uint8_t slot, const struct ql_checkpoint_header *header, uint8_t *state)
+{
+  int fd = cfs_open(checkpoint_files[slot], CFS_READ);
+  int ok;
+
+  if (fd < 0){
+    return 0;
+  }
+  ok = cfs_seek(fd, sizeof(*header), CFS_SEEK_SET) == sizeof(*header) &&
+       cfs_read(fd, state, header->state_len) == header->state_len;
+  cfs_close(fd);
+  return ok && header->crc == crc16_data(state, header->state_len, 0);
+}
+
+// read the newest valid checkpoint back, the older file if the newer one is corrupted
+uint16_t ql_checkpoint_restore(uint8_t *state, uint16_t max_len, uint32_t *cycles_since_start,
+                               uint16_t *current_action)
+{
+  struct ql_checkpoint_header headers[2];
+  uint8_t valid[2];
+  uint8_t newest;
+
+  valid[0] = read_header(0, &headers[0], max_len);
+  valid[1] = read_header(1, &headers[1], max_len);
+  if (!valid[0] && !valid[1]){
+    LOG_INFO("no checkpoint for this configuration, starting from scratch\n");
+    return 0;
+  }
+  newest = !valid[0] || (valid[1] && headers[1].sequence > headers[0].sequence);
+
+  for (uint8_t i = 0; i < 2; i++){
+    uint8_t slot = newest ^ i;
+    if (!valid[slot]){
+      continue;
+    }
+    if (!read_state(slot, &headers[slot], state)){
+      LOG_ERR("checkpoint %s is corrupted\n", checkpoint_files[slot]);
+      continue;
+    }
+    // the next checkpoint overwrites the other file
+    checkpoint_slot = slot;
+    checkpoint_sequence = headers[slot].sequence;
+    *cycles_since_start = headers[slot].cycles_since_start;
+    *current_action = headers[slot].current_action;
+    LOG_INFO("restored checkpoint %lu, cycles %lu action %u\n", (unsigned long)headers[slot].sequence,
+             (unsigned long)headers[slot].cycles_since_start, headers[slot].current_action);
+    return headers[slot].state_len;
+  }
+  LOG_ERR("no valid checkpoint, starting from scratch\n");
+  return 0;
+}
+
+// delete the checkpoint files
+void ql_checkpoint_remove(void)
+{
+  cfs_remove(checkpoint_files[0]);
+  cfs_remove(checkpoint_files[1]);
+  checkpoint_slot = 1;
+  checkpoint_sequence = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef QL_CHECKPOINT_H_
+#define QL_CHECKPOINT_H_
+
+/********** Libraries ***********/
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "ql-fixed-point.h"
+
+/********** Configuration ***********/
+
+// save the learned state to non-volatile storage (CFS) and restore it at boot
+#ifdef QL_CHECKPOINT_CONF
+#define QL_CHECKPOINT QL_CHECKPOINT_CONF
+#else
+#define QL_CHECKPOINT 0
+#endif
+
+// number of unicast slotframes between two checks for a checkpoint (the check itself is cheap,
+// the file is only written when the conditions below hold)
+#ifdef QL_CHECKPOINT_INTERVAL_CONF
+#define QL_CHECKPOINT_INTERVAL QL_CHECKPOINT_INTERVAL_CONF
+#else
+#define QL_CHECKPOINT_INTERVAL 100
+#endif
+
+// minimum time between two writes of the checkpoint file, in minutes (limits the flash wear).
+// With QL_CONVERGENCE the first checkpoint is written as soon as the learning converged
+#ifdef QL_CHECKPOINT_MIN_INTERVAL_CONF
+#define QL_CHECKPOINT_MIN_INTERVAL QL_CHECKPOINT_MIN_INTERVAL_CONF
+#else
+#define QL_CHECKPOINT_MIN_INTERVAL 30
+#endif
+
+// a checkpoint is only written when the learned (greedy) action changed or when a Q-value moved by
+// more than this since the last checkpoint
+#ifdef QL_CHECKPOINT_MIN_CHANGE_CONF
+#define QL_CHECKPOINT_MIN_CHANGE QL_CHECKPOINT_MIN_CHANGE_CONF
+#else
+#define QL_CHECKPOINT_MIN_CHANGE Q_FROM_FLOAT(0.25)
+#endif
+
+// base name of the two checkpoint files (".0" and ".1" are appended)
+#ifdef QL_CHECKPOINT_FILE_CONF
+#define QL_CHECKPOINT_FILE QL_CHECKPOINT_FILE_CONF
+#else
+#define QL_CHECKPOINT_FILE "ql-tsch.ckpt"
+#endif
+
+/********** Functions ***********/
+
+// write the serialized learner state, the cycle counter and the learned action to the older of the
+// two checkpoint files (the newest checkpoint is never removed), returns 1 on success
+int ql_checkpoint_save(const uint8_t *state, uint16_t state_len, uint32_t cycles_since_start,
+                       uint16_t current_action);
+
+// read the newest checkpoint back into state (at most max_len bytes), returns the length of the state.
+// Returns 0 if there is no checkpoint, or none written for this configuration that is not corrupted,
+// state must not be used then
+uint16_t ql_checkpoint_restore(uint8_t *state, uint16_t max_len, uint32_t *cycles_since_start,
+                               uint16_t *current_action);
+
+// delete the checkpoint files, used when a checkpoint cannot be restored so it is not read again
+void ql_checkpoint_remove(void);
+
+#endif /* QL_CHECKPOINT_H_ */
@@ -0,0 +1,93 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include "lib/random.h"
+
+#include "ql-exploration.h"
+#include "ql-learner.h"
+
+/********** Global variables ***********/
+
+// schedule in use
+static ql_exploration_schedule_t exploration_schedule = QL_EXPLORATION_SCHEDULE;
+
+// averaged Tx success rate, starts pessimistic so a new node explores
+static q_value_t success_rate = 0;
+
+/********** Schedules ***********/
+
+// min(QL_EPSILON, K / cycles)
+q_value_t ql_exploration_inverse_time(uint32_t cycles)
+{
+  q_value_t epsilon;
+  if (cycles <= QL_EXPLORATION_INVERSE_TIME_K){
+    return QL_EPSILON;
+  }
+  epsilon = Q_FROM_FRACTION(QL_EXPLORATION_INVERSE_TIME_K, cycles);
+  if (epsilon > QL_EPSILON) epsilon = QL_EPSILON;
+  if (epsilon < QL_EPSILON_MIN) epsilon = QL_EPSILON_MIN;
+  return epsilon;
+}
+
+// QL_EPSILON * 2^(-cycles / half life), whole half lives are shifts, the rest is exp(-ln2 * frac)
+q_value_t ql_exploration_exponential(uint32_t cycles)
+{
+  uint32_t halvings = cycles / QL_EXPLORATION_HALF_LIFE;
+  q_value_t epsilon;
+  if (halvings >= 31){
+    return QL_EPSILON_MIN;
+  }
+  epsilon = Q_MUL(QL_EPSILON, q_exp(-Q_MUL(Q_FROM_FLOAT(0.693147),
+                  Q_FROM_FRACTION(cycles % QL_EXPLORATION_HALF_LIFE, QL_EXPLORATION_HALF_LIFE))));
+#if QL_FIXED_POINT
+  epsilon >>= halvings;
+#else
+  epsilon = ldexpf(epsilon, -(int)halvings);
+#endif /* QL_FIXED_POINT */
+  return epsilon < QL_EPSILON_MIN ? QL_EPSILON_MIN : epsilon;
+}
+
+// straight line from QL_EPSILON to QL_EPSILON_MIN
+q_value_t ql_exploration_linear(uint32_t cycles)
+{
+  if (cycles >= QL_EXPLORATION_LINEAR_CYCLES){
+    return QL_EPSILON_MIN;
+  }
+  return QL_EPSILON - Q_MUL(QL_EPSILON - QL_EPSILON_MIN,
+                            Q_FROM_FRACTION(cycles, QL_EXPLORATION_LINEAR_CYCLES));
+}
+
+// the failure rate picks a point between QL_EPSILON_MIN and QL_EPSILON
+q_value_t ql_exploration_adaptive(uint32_t cycles)
+{
+  return QL_EPSILON_MIN + Q_MUL(QL_EPSILON - QL_EPSILON_MIN, Q_ONE - success_rate);
+}
+
+/********** Functions ***********/
+
+// change the schedule at runtime
+void ql_exploration_set_schedule(ql_exploration_schedule_t schedule)
+{
+  exploration_schedule = schedule;
+}
+
+// exploration probability of the current schedule
+q_value_t ql_exploration_epsilon(uint32_t cycles)
+{
+  return exploration_schedule(cycles);
+}
+
+// draw exploration (1) or exploitation (0) with the current schedule
+uint8_t ql_exploration_explore(uint32_t cycles)
+{
+  return ql_learner_random() < exploration_schedule(cycles);
+}
+
+// exponential moving average of the Tx success rate, idle slotframes leave it alone
+void ql_exploration_feedback(uint16_t tx_ok, uint16_t tx_failed)
+{
+  uint32_t total = (uint32_t)tx_ok + tx_failed;
+  if (total == 0){
+    return;
+  }
+  success_rate += Q_MUL(QL_EXPLORATION_ADAPTIVE_ALPHA, Q_FROM_FRACTION(tx_ok, total) - success_rate);
+}
@@ -0,0 +1,102 @@
+#ifndef QL_EXPLORATION_H_
+#define QL_EXPLORATION_H_
+
+/********** Libraries ***********/
+#include "contiki.h"
+#include "ql-fixed-point.h"
+
+/********** Configuration ***********/
+
+// exploration probability at the start (and upper bound of every schedule)
+#ifdef QL_EPSILON_CONF
+#define QL_EPSILON QL_EPSILON_CONF
+#else
+#define QL_EPSILON Q_FROM_FLOAT(0.5)
+#endif
+
+// exploration probability the decaying schedules settle at
+#ifdef QL_EPSILON_MIN_CONF
+#define QL_EPSILON_MIN QL_EPSILON_MIN_CONF
+#else
+#define QL_EPSILON_MIN Q_FROM_FLOAT(0.0)
+#endif
+
+// ql_exploration_inverse_time: epsilon = K / cycles (the original QL-TSCH decay with K = 10000)
+#ifdef QL_EXPLORATION_INVERSE_TIME_K_CONF
+#define QL_EXPLORATION_INVERSE_TIME_K QL_EXPLORATION_INVERSE_TIME_K_CONF
+#else
+#define QL_EXPLORATION_INVERSE_TIME_K 10000
+#endif
+
+// ql_exploration_exponential: slotframes for epsilon to halve
+#ifdef QL_EXPLORATION_HALF_LIFE_CONF
+#define QL_EXPLORATION_HALF_LIFE QL_EXPLORATION_HALF_LIFE_CONF
+#else
+#define QL_EXPLORATION_HALF_LIFE 2000
+#endif
+
+// ql_exploration_linear: slotframes to go from QL_EPSILON down to QL_EPSILON_MIN
+#ifdef QL_EXPLORATION_LINEAR_CYCLES_CONF
+#define QL_EXPLORATION_LINEAR_CYCLES QL_EXPLORATION_LINEAR_CYCLES_CONF
+#else
+#define QL_EXPLORATION_LINEAR_CYCLES 20000
+#endif
+
+// ql_exploration_adaptive: weight of the last slotframe in the averaged Tx success rate
+#ifdef QL_EXPLORATION_ADAPTIVE_ALPHA_CONF
+#define QL_EXPLORATION_ADAPTIVE_ALPHA QL_EXPLORATION_ADAPTIVE_ALPHA_CONF
+#else
+#define QL_EXPLORATION_ADAPTIVE_ALPHA Q_FROM_FLOAT(0.05)
+#endif
+
+// explore a timeslot drawn by inverse occupancy instead of always the least occupied one,
+// so that nodes exploring at the same time do not all jump into the same cell
+#ifdef QL_EXPLORATION_WEIGHTED_CONF
+#define QL_EXPLORATION_WEIGHTED QL_EXPLORATION_WEIGHTED_CONF
+#else
+#define QL_EXPLORATION_WEIGHTED 0
+#endif
+
+// the schedule in use at boot, any function of type ql_exploration_schedule_t
+#ifdef QL_EXPLORATION_SCHEDULE_CONF
+#define QL_EXPLORATION_SCHEDULE QL_EXPLORATION_SCHEDULE_CONF
+#else
+#define QL_EXPLORATION_SCHEDULE ql_exploration_inverse_time
+#endif
+
+/********** Data types ***********/
+
+// maps the number of slotframes since the start to the exploration probability
+typedef q_value_t (* ql_exploration_schedule_t)(uint32_t cycles);
+
+/********** Schedules ***********/
+
+// min(QL_EPSILON, K / cycles)
+q_value_t ql_exploration_inverse_time(uint32_t cycles);
+// QL_EPSILON halved every QL_EXPLORATION_HALF_LIFE slotframes, down to QL_EPSILON_MIN
+q_value_t ql_exploration_exponential(uint32_t cycles);
+// straight line from QL_EPSILON to QL_EPSILON_MIN over QL_EXPLORATION_LINEAR_CYCLES slotframes
+q_value_t ql_exploration_linear(uint32_t cycles);
+// between QL_EPSILON_MIN and QL_EPSILON, the more Tx fail the more exploration
+q_value_t ql_exploration_adaptive(uint32_t cycles);
+
+// a user schedule set through QL_EXPLORATION_SCHEDULE_CONF
+#ifdef QL_EXPLORATION_SCHEDULE_CONF
+q_value_t QL_EXPLORATION_SCHEDULE_CONF(uint32_t cycles);
+#endif
+
+/********** Functions ***********/
+
+// change the schedule at runtime
+void ql_exploration_set_schedule(ql_exploration_schedule_t schedule);
+
+// exploration probability of the current schedule
+q_value_t ql_exploration_epsilon(uint32_t cycles);
+
+// draw exploration (1) or exploitation (0) with the current schedule
+uint8_t ql_exploration_explore(uint32_t cycles);
+
+// Tx outcomes of a slotframe, feeds the success rate of the adaptive schedule
+void ql_exploration_feedback(uint16_t tx_ok, uint16_t tx_failed);
+
+#endif /* QL_EXPLORATION_H_ */
@@ -0,0 +1,121 @@
+#ifndef QL_FIXED_POINT_H_
+#define QL_FIXED_POINT_H_
+
+/********** Libraries ***********/
+#include "contiki.h"
+
+/********** Configuration ***********/
+
+// use fixed-point arithmetic instead of float for the Q-learning (no FPU on the motes)
+#ifdef QL_FIXED_POINT_CONF
+#define QL_FIXED_POINT QL_FIXED_POINT_CONF
+#else
+#define QL_FIXED_POINT 0
+#endif
+
+/********** Q-value type and arithmetic ***********/
+#if QL_FIXED_POINT
+
+// signed Q16.16 value
+typedef int32_t q_value_t;
+
+#define Q_FRAC_BITS 16
+#define Q_ONE ((q_value_t)1 << Q_FRAC_BITS)
+
+// conversions, Q_FROM_FLOAT is meant for constants only (folded at compile time)
+#define Q_FROM_FLOAT(x) ((q_value_t)((x) * Q_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+#define Q_FROM_INT(x) ((q_value_t)(x) * Q_ONE)
+#define Q_FROM_FRACTION(n, d) ((q_value_t)(((int64_t)(n) << Q_FRAC_BITS) / (d)))
+
+// multiplication and division with a 64-bit intermediate result
+#define Q_MUL(a, b) ((q_value_t)(((int64_t)(a) * (b)) >> Q_FRAC_BITS))
+#define Q_DIV(a, b) ((q_value_t)(((int64_t)(a) << Q_FRAC_BITS) / (b)))
+
+// print a value as "[-]int.frac" with three decimals
+#define Q_ABS(x) ((x) < 0 ? -(x) : (x))
+#define Q_PRINTF_FMT "%s%ld.%03lu"
+#define Q_PRINTF_ARGS(x) ((x) < 0 ? "-" : ""), (long)(Q_ABS(x) >> Q_FRAC_BITS), \
+                         (unsigned long)(((uint32_t)(Q_ABS(x) & (Q_ONE - 1)) * 1000) >> Q_FRAC_BITS)
+
+// largest value, used for saturation
+#define Q_MAX ((q_value_t)0x7fffffff)
+
+// square root of a non-negative value (bitwise integer square root of x << Q_FRAC_BITS)
+static inline q_value_t q_sqrt(q_value_t x)
+{
+  uint64_t v = (uint64_t)(x < 0 ? 0 : x) << Q_FRAC_BITS;
+  uint64_t bit = (uint64_t)1 << 62;
+  uint64_t res = 0;
+  while (bit > v) bit >>= 2;
+  while (bit != 0){
+    if (v >= res + bit){
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (q_value_t)res;
+}
+
+// natural logarithm of a positive value, log2 of the mantissa is approximated by f * (1.3465 - 0.3465 f)
+static inline q_value_t q_log(q_value_t x)
+{
+  int exponent = 0;
+  q_value_t f;
+  if (x <= 0) return -Q_MAX;
+  while (x >= 2 * Q_ONE){ x >>= 1; exponent++; }
+  while (x < Q_ONE){ x <<= 1; exponent--; }
+  f = x - Q_ONE;
+  return Q_MUL(Q_FROM_INT(exponent) + Q_MUL(f, Q_FROM_FLOAT(1.3465) - Q_MUL(Q_FROM_FLOAT(0.3465), f)),
+               Q_FROM_FLOAT(0.693147));
+}
+
+// e^x, 2^f of the fractional part is approximated by 1 + f * (0.6565 + 0.3435 f), saturates at Q_MAX
+static inline q_value_t q_exp(q_value_t x)
+{
+  q_value_t y = Q_MUL(x, Q_FROM_FLOAT(1.442695));
+  int32_t i = y >> Q_FRAC_BITS;  // floor
+  q_value_t f = y - Q_FROM_INT(i);
+  q_value_t m = Q_ONE + Q_MUL(f, Q_FROM_FLOAT(0.6565) + Q_MUL(Q_FROM_FLOAT(0.3435), f));
+  if (i >= 31 - Q_FRAC_BITS - 1) return Q_MAX;
+  if (i <= -Q_FRAC_BITS - 1) return 0;
+  return i >= 0 ? m << i : m >> -i;
+}
+
+#else /* QL_FIXED_POINT */
+
+typedef float q_value_t;
+
+#define Q_ONE 1.0f
+
+#define Q_FROM_FLOAT(x) ((q_value_t)(x))
+#define Q_FROM_INT(x) ((q_value_t)(x))
+#define Q_FROM_FRACTION(n, d) ((q_value_t)(n) / (d))
+
+#define Q_MUL(a, b) ((a) * (b))
+#define Q_DIV(a, b) ((a) / (b))
+
+#define Q_PRINTF_FMT "%f"
+#define Q_PRINTF_ARGS(x) ((double)(x))
+
+#define Q_MAX 3.0e38f
+
+#include <math.h>
+#define q_sqrt(x) sqrtf(x)
+#define q_log(x) logf(x)
+#define q_exp(x) expf(x)
+
+#endif /* QL_FIXED_POINT */
+
+/********** Q-learning ***********/
+
+// one Q-learning step, as in QL-TSCH: (1 - alpha) q + alpha (reward + gamma max_q - q)
+static inline q_value_t q_learning_update(q_value_t q, q_value_t reward, q_value_t max_q,
+                                          q_value_t alpha, q_value_t gamma)
+{
+  return Q_MUL(Q_ONE - alpha, q) + Q_MUL(alpha, reward + Q_MUL(gamma, max_q) - q);
+}
+
+#endif /* QL_FIXED_POINT_H_ */
@@ -0,0 +1,142 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include "lib/random.h"
+#include <string.h>
+
+#include "ql-learner.h"
+#include "ql-reward.h"
+#include "ql-exploration.h"
+
+/********** Configuration ***********/
+
+// tag of the serialized state
+#define QL_TSCH_STATE_TAG 'Q'
+
+/********** Global variables ***********/
+
+// array to store Q-values of the actions (timeslot x channel offset cells)
+static q_value_t q_values[QL_NUM_ACTIONS];
+
+// row of the Q-table ranked by the index
+static uint16_t q_row = 0;
+
+// higher Q-values rank higher in the Q-value index (timeslots of the current row)
+static int q_value_compare(uint16_t a, uint16_t b)
+{
+  q_value_t qa = q_values[QL_ACTION(a, q_row)];
+  q_value_t qb = q_values[QL_ACTION(b, q_row)];
+  return (qa > qb) - (qa < qb);
+}
+
+// argmax index over the Q-values of the current row, updated whenever a Q-value changes
+TSCH_QL_INDEX(q_value_index, UNICAST_SLOTFRAME_LENGTH, q_value_compare);
+
+/********** Functions ***********/
+
+// follow the row of the parent
+static void set_row(uint16_t row)
+{
+  if (row != q_row){
+    q_row = row;
+    tsch_ql_index_init(&q_value_index);
+  }
+}
+
+// set all Q-values to 0
+static void ql_tsch_init(void)
+{
+  memset(q_values, 0, sizeof(q_values));
+  tsch_ql_index_init(&q_value_index);
+}
+
+// add the next best cells of the row after the primary action, returns the number of cells
+static uint8_t add_extra_tx_cells(uint16_t *actions, uint8_t num)
+{
+  uint8_t count = 1;
+  tsch_ql_index_exclude(&q_value_index, QL_ACTION_TIMESLOT(actions[0]));
+  while (count < num && count < UNICAST_SLOTFRAME_LENGTH){
+    uint16_t timeslot = tsch_ql_index_best(&q_value_index);
+    actions[count++] = QL_ACTION(timeslot, q_row);
+    tsch_ql_index_exclude(&q_value_index, timeslot);
+  }
+  // put the picked cells back into the ranking
+  for (uint8_t i = 0; i < count; i++){
+    tsch_ql_index_include(&q_value_index, QL_ACTION_TIMESLOT(actions[i]));
+  }
+  return count;
+}
+
+// explore the least used timeslot (APT) or exploit the highest Q-value, then the next best cells
+static uint8_t ql_tsch_select(const struct ql_learner_context *ctx, uint16_t *actions, uint8_t num)
+{
+  set_row(ctx->row);
+  // epsilon-greedy, epsilon follows the exploration schedule
+  if (ql_exploration_explore(ctx->cycles)){ /* Exploration */
+#if QL_EXPLORATION_WEIGHTED
+    actions[0] = QL_ACTION(get_slot_with_apt_table_weighted(ctx->busy_timeslots), q_row);
+#else
+    if (ctx->busy_timeslots != NULL){
+      actions[0] = QL_ACTION(get_slot_with_apt_table_min_value_excluding(ctx->busy_timeslots), q_row);
+    } else {
+      actions[0] = QL_ACTION(get_slot_with_apt_table_min_value(), q_row);
+    }
+#endif /* QL_EXPLORATION_WEIGHTED */
+  } else { /* Explotation */
+    actions[0] = QL_ACTION(tsch_ql_index_best(&q_value_index), q_row);
+  }
+  return add_extra_tx_cells(actions, num);
+}
+
+// Update q-value table function
+static void ql_tsch_update(const struct ql_learner_context *ctx, uint16_t action, q_value_t reward)
+{
+  uint16_t max;
+  q_value_t expected_max_q_value;
+
+  set_row(ctx->row);
+  // only the highest value is needed here, no need to draw among ties
+  max = QL_ACTION(tsch_ql_index_peek(&q_value_index), q_row);
+  expected_max_q_value = q_values[max] + Q_FROM_INT(QL_REWARD_SUCCESS);
+  q_values[action] = q_learning_update(q_values[action], reward, expected_max_q_value,
+                                       QL_LEARNING_RATE, QL_DISCOUNT_FACTOR);
+  if (QL_ACTION_CHANNEL_OFFSET(action) == q_row){
+    tsch_ql_index_update(&q_value_index, QL_ACTION_TIMESLOT(action));
+  }
+}
+
+// Q-value of a cell
+static q_value_t ql_tsch_value(uint16_t action)
+{
+  return q_values[action];
+}
+
+// the state is a tag and the Q-values
+static int ql_tsch_serialize(uint8_t *buf, uint16_t len)
+{
+  if (len < 1 + sizeof(q_values)){
+    return -1;
+  }
+  buf[0] = QL_TSCH_STATE_TAG;
+  memcpy(buf + 1, q_values, sizeof(q_values));
+  return 1 + sizeof(q_values);
+}
+
+static int ql_tsch_deserialize(const uint8_t *buf, uint16_t len)
+{
+  if (len != 1 + sizeof(q_values) || buf[0] != QL_TSCH_STATE_TAG){
+    return 0;
+  }
+  memcpy(q_values, buf + 1, sizeof(q_values));
+  tsch_ql_index_init(&q_value_index);
+  return 1;
+}
+
+const struct ql_learner ql_learner_ql_tsch = {
+  "QL-TSCH",
+  ql_tsch_init,
+  ql_tsch_select,
+  ql_tsch_update,
+  ql_tsch_value,
+  ql_tsch_serialize,
+  ql_tsch_deserialize,
+};
@@ -0,0 +1,115 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include <string.h>
+
+#include "ql-learner.h"
+#include "ql-reward.h"
+
+/********** Configuration ***********/
+
+// Boltzmann temperature, higher values explore more
+#ifdef QL_SOFTMAX_TEMPERATURE_CONF
+#define QL_SOFTMAX_TEMPERATURE QL_SOFTMAX_TEMPERATURE_CONF
+#else
+#define QL_SOFTMAX_TEMPERATURE Q_FROM_FLOAT(0.1)
+#endif
+
+// tag of the serialized state
+#define SOFTMAX_STATE_TAG 'S'
+
+/********** Global variables ***********/
+
+// Q-values of the actions (timeslot x channel offset cells)
+static q_value_t q_values[QL_NUM_ACTIONS];
+
+/********** Functions ***********/
+
+// highest Q-value of a row
+static q_value_t max_q_value(uint16_t row)
+{
+  q_value_t max = q_values[QL_ACTION(0, row)];
+  for (uint16_t ts = 1; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    if (q_values[QL_ACTION(ts, row)] > max) max = q_values[QL_ACTION(ts, row)];
+  }
+  return max;
+}
+
+// set all Q-values to 0
+static void softmax_init(void)
+{
+  memset(q_values, 0, sizeof(q_values));
+}
+
+// draw cells with probabilities exp(Q / T) (relative to the highest Q, so no overflow), without replacement
+static uint8_t softmax_select(const struct ql_learner_context *ctx, uint16_t *actions, uint8_t num)
+{
+  q_value_t weights[UNICAST_SLOTFRAME_LENGTH];
+  q_value_t max = max_q_value(ctx->row);
+  q_value_t sum = 0;
+  uint8_t count = 0;
+
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    weights[ts] = q_exp(Q_DIV(q_values[QL_ACTION(ts, ctx->row)] - max, QL_SOFTMAX_TEMPERATURE));
+    sum += weights[ts];
+  }
+
+  while (count < num && count < UNICAST_SLOTFRAME_LENGTH && sum > 0){
+    q_value_t r = Q_MUL(ql_learner_random(), sum);
+    uint16_t pick = 0;
+    // the last cell with a weight takes what rounding leaves over
+    for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+      if (weights[ts] == 0) continue;
+      pick = ts;
+      if (r < weights[ts]) break;
+      r -= weights[ts];
+    }
+    actions[count++] = QL_ACTION(pick, ctx->row);
+    sum -= weights[pick];
+    weights[pick] = 0;
+  }
+  return count;
+}
+
+// Q-learning update, as in QL-TSCH
+static void softmax_update(const struct ql_learner_context *ctx, uint16_t action, q_value_t reward)
+{
+  q_value_t expected_max_q_value = max_q_value(ctx->row) + Q_FROM_INT(QL_REWARD_SUCCESS);
+  q_values[action] = q_learning_update(q_values[action], reward, expected_max_q_value,
+                                       QL_LEARNING_RATE, QL_DISCOUNT_FACTOR);
+}
+
+// Q-value of a cell
+static q_value_t softmax_value(uint16_t action)
+{
+  return q_values[action];
+}
+
+// the state is a tag and the Q-values
+static int softmax_serialize(uint8_t *buf, uint16_t len)
+{
+  if (len < 1 + sizeof(q_values)){
+    return -1;
+  }
+  buf[0] = SOFTMAX_STATE_TAG;
+  memcpy(buf + 1, q_values, sizeof(q_values));
+  return 1 + sizeof(q_values);
+}
+
+static int softmax_deserialize(const uint8_t *buf, uint16_t len)
+{
+  if (len != 1 + sizeof(q_values) || buf[0] != SOFTMAX_STATE_TAG){
+    return 0;
+  }
+  memcpy(q_values, buf + 1, sizeof(q_values));
+  return 1;
+}
+
+const struct ql_learner ql_learner_softmax = {
+  "softmax",
+  softmax_init,
+  softmax_select,
+  softmax_update,
+  softmax_value,
+  softmax_serialize,
+  softmax_deserialize,
+};
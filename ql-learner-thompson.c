@@ -0,0 +1,145 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include <string.h>
+
+#include "ql-learner.h"
+#include "ql-reward.h"
+
+/********** Configuration ***********/
+
+// alpha + beta of a cell is scaled down to this, so old outcomes fade and the sampler keeps adapting
+#ifdef QL_THOMPSON_MAX_COUNT_CONF
+#define QL_THOMPSON_MAX_COUNT QL_THOMPSON_MAX_COUNT_CONF
+#else
+#define QL_THOMPSON_MAX_COUNT 50
+#endif
+
+// Beta(a, b) is drawn exactly as an order statistic of uniforms up to this many uniforms,
+// and from a normal approximation above
+#define THOMPSON_EXACT_MAX 12
+
+// tag of the serialized state
+#define THOMPSON_STATE_TAG 'T'
+
+/********** Global variables ***********/
+
+// Beta posterior of the success probability of every cell (uniform prior: 1, 1)
+static q_value_t alphas[QL_NUM_ACTIONS];
+static q_value_t betas[QL_NUM_ACTIONS];
+
+/********** Functions ***********/
+
+// round a pseudo-count to an integer of at least 1
+static uint16_t round_count(q_value_t x)
+{
+  int32_t n = (int32_t)(x + Q_FROM_FLOAT(0.5));
+#if QL_FIXED_POINT
+  n >>= Q_FRAC_BITS;
+#endif /* QL_FIXED_POINT */
+  return n < 1 ? 1 : n;
+}
+
+// draw from Beta(alpha, beta)
+static q_value_t sample_beta(q_value_t alpha, q_value_t beta)
+{
+  uint16_t a = round_count(alpha);
+  uint16_t b = round_count(beta);
+
+  if (a + b - 1 <= THOMPSON_EXACT_MAX){
+    // the a-th smallest of a + b - 1 uniforms is Beta(a, b) distributed
+    q_value_t u[THOMPSON_EXACT_MAX];
+    uint16_t n = a + b - 1;
+    for (uint16_t i = 0; i < n; i++){
+      q_value_t x = ql_learner_random();
+      uint16_t j = i;
+      // insertion sort
+      while (j > 0 && u[j - 1] > x){
+        u[j] = u[j - 1];
+        j--;
+      }
+      u[j] = x;
+    }
+    return u[a - 1];
+  } else {
+    // mean and deviation of the Beta, times an Irwin-Hall (4 uniforms) approximation of N(0, 1)
+    q_value_t mean = Q_DIV(alpha, alpha + beta);
+    q_value_t deviation = q_sqrt(Q_DIV(Q_MUL(mean, Q_ONE - mean), alpha + beta + Q_ONE));
+    q_value_t z = ql_learner_random() + ql_learner_random() + ql_learner_random() + ql_learner_random() - 2 * Q_ONE;
+    q_value_t x = mean + Q_MUL(deviation, Q_MUL(z, Q_FROM_FLOAT(1.732051)));
+    return x < 0 ? 0 : (x > Q_ONE ? Q_ONE : x);
+  }
+}
+
+// forget everything
+static void thompson_init(void)
+{
+  for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++){
+    alphas[i] = Q_ONE;
+    betas[i] = Q_ONE;
+  }
+}
+
+// the cells with the highest draws from their posteriors
+static uint8_t thompson_select(const struct ql_learner_context *ctx, uint16_t *actions, uint8_t num)
+{
+  q_value_t samples[UNICAST_SLOTFRAME_LENGTH];
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    uint16_t a = QL_ACTION(ts, ctx->row);
+    samples[ts] = sample_beta(alphas[a], betas[a]);
+  }
+  return ql_learner_pick_top(samples, ctx->row, actions, num);
+}
+
+// a reward between the failure and the success reward counts as a partial success
+static void thompson_update(const struct ql_learner_context *ctx, uint16_t action, q_value_t reward)
+{
+  q_value_t success = Q_DIV(reward - Q_FROM_INT(QL_REWARD_FAILURE),
+                            Q_FROM_INT(QL_REWARD_SUCCESS) - Q_FROM_INT(QL_REWARD_FAILURE));
+  if (success < 0) success = 0;
+  if (success > Q_ONE) success = Q_ONE;
+
+  alphas[action] += success;
+  betas[action] += Q_ONE - success;
+  if (alphas[action] + betas[action] > Q_FROM_INT(QL_THOMPSON_MAX_COUNT)){
+    alphas[action] = Q_MUL(alphas[action], Q_FROM_FRACTION(QL_THOMPSON_MAX_COUNT - 1, QL_THOMPSON_MAX_COUNT));
+    betas[action] = Q_MUL(betas[action], Q_FROM_FRACTION(QL_THOMPSON_MAX_COUNT - 1, QL_THOMPSON_MAX_COUNT));
+  }
+}
+
+// posterior mean of the success probability of a cell
+static q_value_t thompson_value(uint16_t action)
+{
+  return Q_DIV(alphas[action], alphas[action] + betas[action]);
+}
+
+// the state is a tag, the alphas and the betas
+static int thompson_serialize(uint8_t *buf, uint16_t len)
+{
+  if (len < 1 + sizeof(alphas) + sizeof(betas)){
+    return -1;
+  }
+  buf[0] = THOMPSON_STATE_TAG;
+  memcpy(buf + 1, alphas, sizeof(alphas));
+  memcpy(buf + 1 + sizeof(alphas), betas, sizeof(betas));
+  return 1 + sizeof(alphas) + sizeof(betas);
+}
+
+static int thompson_deserialize(const uint8_t *buf, uint16_t len)
+{
+  if (len != 1 + sizeof(alphas) + sizeof(betas) || buf[0] != THOMPSON_STATE_TAG){
+    return 0;
+  }
+  memcpy(alphas, buf + 1, sizeof(alphas));
+  memcpy(betas, buf + 1 + sizeof(alphas), sizeof(betas));
+  return 1;
+}
+
+const struct ql_learner ql_learner_thompson = {
+  "Thompson",
+  thompson_init,
+  thompson_select,
+  thompson_update,
+  thompson_value,
+  thompson_serialize,
+  thompson_deserialize,
+};
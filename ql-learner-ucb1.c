@@ -0,0 +1,120 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include <string.h>
+
+#include "ql-learner.h"
+
+/********** Configuration ***********/
+
+// weight of the exploration bonus, sqrt(2) in the original UCB1
+#ifdef QL_UCB1_EXPLORATION_CONF
+#define QL_UCB1_EXPLORATION QL_UCB1_EXPLORATION_CONF
+#else
+#define QL_UCB1_EXPLORATION Q_FROM_FLOAT(1.414)
+#endif
+
+// the mean of a cell follows at least 1 / QL_UCB1_MAX_COUNT of every new reward,
+// so the bandit keeps tracking a changing channel
+#ifdef QL_UCB1_MAX_COUNT_CONF
+#define QL_UCB1_MAX_COUNT QL_UCB1_MAX_COUNT_CONF
+#else
+#define QL_UCB1_MAX_COUNT 100
+#endif
+
+// tag of the serialized state
+#define UCB1_STATE_TAG 'U'
+
+/********** Global variables ***********/
+
+// mean reward and number of rewards of every cell, and the number of rewards in total
+static q_value_t means[QL_NUM_ACTIONS];
+static uint16_t counts[QL_NUM_ACTIONS];
+static uint32_t total_count;
+
+/********** Functions ***********/
+
+// natural logarithm of a count, scaled down first so it fits in a q_value_t
+static q_value_t log_count(uint32_t n)
+{
+  uint8_t shift = 0;
+  while (n >= (1UL << 14)){
+    n >>= 1;
+    shift++;
+  }
+  return q_log(Q_FROM_INT(n)) + shift * Q_FROM_FLOAT(0.693147);
+}
+
+// forget everything
+static void ucb1_init(void)
+{
+  memset(means, 0, sizeof(means));
+  memset(counts, 0, sizeof(counts));
+  total_count = 0;
+}
+
+// the cells with the highest mean + c * sqrt(ln(total) / count), untried cells first
+static uint8_t ucb1_select(const struct ql_learner_context *ctx, uint16_t *actions, uint8_t num)
+{
+  q_value_t scores[UNICAST_SLOTFRAME_LENGTH];
+  q_value_t log_total = log_count(total_count > 0 ? total_count : 1);
+
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    uint16_t a = QL_ACTION(ts, ctx->row);
+    if (counts[a] == 0){
+      scores[ts] = Q_MAX;
+    } else {
+      scores[ts] = means[a] + Q_MUL(QL_UCB1_EXPLORATION, q_sqrt(log_total / counts[a]));
+    }
+  }
+  return ql_learner_pick_top(scores, ctx->row, actions, num);
+}
+
+// running mean of the rewards of a cell
+static void ucb1_update(const struct ql_learner_context *ctx, uint16_t action, q_value_t reward)
+{
+  if (counts[action] < QL_UCB1_MAX_COUNT){
+    counts[action]++;
+  }
+  total_count++;
+  means[action] += (reward - means[action]) / counts[action];
+}
+
+// mean reward of a cell
+static q_value_t ucb1_value(uint16_t action)
+{
+  return means[action];
+}
+
+// the state is a tag, the means, the counts and the total count
+static int ucb1_serialize(uint8_t *buf, uint16_t len)
+{
+  if (len < 1 + sizeof(means) + sizeof(counts) + sizeof(total_count)){
+    return -1;
+  }
+  buf[0] = UCB1_STATE_TAG;
+  memcpy(buf + 1, means, sizeof(means));
+  memcpy(buf + 1 + sizeof(means), counts, sizeof(counts));
+  memcpy(buf + 1 + sizeof(means) + sizeof(counts), &total_count, sizeof(total_count));
+  return 1 + sizeof(means) + sizeof(counts) + sizeof(total_count);
+}
+
+static int ucb1_deserialize(const uint8_t *buf, uint16_t len)
+{
+  if (len != 1 + sizeof(means) + sizeof(counts) + sizeof(total_count) || buf[0] != UCB1_STATE_TAG){
+    return 0;
+  }
+  memcpy(means, buf + 1, sizeof(means));
+  memcpy(counts, buf + 1 + sizeof(means), sizeof(counts));
+  memcpy(&total_count, buf + 1 + sizeof(means) + sizeof(counts), sizeof(total_count));
+  return 1;
+}
+
+const struct ql_learner ql_learner_ucb1 = {
+  "UCB1",
+  ucb1_init,
+  ucb1_select,
+  ucb1_update,
+  ucb1_value,
+  ucb1_serialize,
+  ucb1_deserialize,
+};
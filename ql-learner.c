@@ -0,0 +1,40 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include "lib/random.h"
+#include <string.h>
+
+#include "ql-learner.h"
+
+/********** Functions ***********/
+
+// uniform random value in [0, 1)
+q_value_t ql_learner_random(void)
+{
+  return Q_FROM_FRACTION(random_rand(), (uint32_t)RANDOM_RAND_MAX + 1);
+}
+
+// put the num timeslots with the highest scores as actions of a row
+uint8_t ql_learner_pick_top(const q_value_t *scores, uint16_t row, uint16_t *actions, uint8_t num)
+{
+  uint8_t picked[UNICAST_SLOTFRAME_LENGTH];
+  uint8_t count = 0;
+
+  memset(picked, 0, sizeof(picked));
+  while (count < num && count < UNICAST_SLOTFRAME_LENGTH){
+    uint16_t best = 0;
+    uint16_t ties = 0;
+    for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+      if (picked[ts]) continue;
+      if (ties == 0 || scores[ts] > scores[best]){
+        best = ts;
+        ties = 1;
+      } else if (scores[ts] == scores[best] && random_rand() % ++ties == 0){
+        // reservoir sampling among the tied timeslots
+        best = ts;
+      }
+    }
+    picked[best] = 1;
+    actions[count++] = QL_ACTION(best, row);
+  }
+  return count;
+}
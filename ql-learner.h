@@ -0,0 +1,80 @@
+#ifndef QL_LEARNER_H_
+#define QL_LEARNER_H_
+
+/********** Libraries ***********/
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "ql-fixed-point.h"
+
+/********** Configuration ***********/
+
+// the learner choosing the Tx cells, one of the drivers declared below
+#ifdef QL_LEARNER_CONF
+#define QL_LEARNER QL_LEARNER_CONF
+#else
+#define QL_LEARNER ql_learner_ql_tsch
+#endif
+
+// Q-learning parameters (QL-TSCH and softmax learners)
+#ifdef QL_LEARNING_RATE_CONF
+#define QL_LEARNING_RATE QL_LEARNING_RATE_CONF
+#else
+#define QL_LEARNING_RATE Q_FROM_FLOAT(0.1)
+#endif
+
+#ifdef QL_DISCOUNT_FACTOR_CONF
+#define QL_DISCOUNT_FACTOR QL_DISCOUNT_FACTOR_CONF
+#else
+#define QL_DISCOUNT_FACTOR Q_FROM_FLOAT(0.95)
+#endif
+
+// largest serialized state of the learners (Thompson sampling: two values per action)
+#define QL_LEARNER_STATE_MAX (2 * QL_NUM_ACTIONS * sizeof(q_value_t) + sizeof(uint32_t))
+
+/********** Data types ***********/
+
+// what a learner knows about the node when it selects or learns
+struct ql_learner_context {
+  uint16_t row;                   // channel offset of the parent, only cells of this row reach it
+  uint32_t cycles;                // slotframes since the start
+  const uint8_t *busy_timeslots;  // bitmap of timeslots busy two hops away, NULL if not known
+};
+
+// a learner over the (timeslot, channel offset) cells of the unicast slotframe
+struct ql_learner {
+  const char *name;
+  // reset the learned state
+  void (* init)(void);
+  // pick up to num distinct Tx cells (primary first) in the row of the context, returns how many
+  uint8_t (* select)(const struct ql_learner_context *ctx, uint16_t *actions, uint8_t num);
+  // learn the reward of a Tx in a cell
+  void (* update)(const struct ql_learner_context *ctx, uint16_t action, q_value_t reward);
+  // value of a cell, for logging
+  q_value_t (* value)(uint16_t action);
+  // write the learned state to buf, returns the number of bytes or -1 if buf is too small
+  int (* serialize)(uint8_t *buf, uint16_t len);
+  // read the learned state back, returns 1 on success and 0 if buf does not hold such a state
+  int (* deserialize)(const uint8_t *buf, uint16_t len);
+};
+
+/********** Learners ***********/
+
+// QL-TSCH: Q-learning, epsilon-greedy with exploration through the least used (APT) timeslot
+extern const struct ql_learner ql_learner_ql_tsch;
+// UCB1 bandit over the cells
+extern const struct ql_learner ql_learner_ucb1;
+// Q-learning with Boltzmann (softmax) exploration
+extern const struct ql_learner ql_learner_softmax;
+// Beta-Bernoulli Thompson sampling
+extern const struct ql_learner ql_learner_thompson;
+
+/********** Helpers for the learners ***********/
+
+// uniform random value in [0, 1)
+q_value_t ql_learner_random(void);
+
+// put the num timeslots with the highest scores (ties broken at random) as actions of a row,
+// returns how many were picked
+uint8_t ql_learner_pick_top(const q_value_t *scores, uint16_t row, uint16_t *actions, uint8_t num);
+
+#endif /* QL_LEARNER_H_ */
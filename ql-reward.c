@@ -0,0 +1,63 @@
+/********** Libraries ***********/
+#include "contiki.h"
+#include "net/mac/mac.h"
+
+#include "ql-reward.h"
+
+// the base reward of ql_reward_energy, if set to a user function
+#ifdef QL_REWARD_ENERGY_BASE_CONF
+q_value_t QL_REWARD_ENERGY_BASE_CONF(const struct tsch_ql_tx_outcome *outcome);
+#endif
+
+/********** Functions ***********/
+
+// the original reward: success or failure only
+q_value_t ql_reward_binary(const struct tsch_ql_tx_outcome *outcome)
+{
+  return outcome->status == 1 ? Q_FROM_INT(QL_REWARD_SUCCESS) : Q_FROM_INT(QL_REWARD_FAILURE);
+}
+
+// reward that also prefers first-try successes, short queueing and good links
+q_value_t ql_reward_latency(const struct tsch_ql_tx_outcome *outcome)
+{
+  q_value_t reward;
+
+  if (outcome->status != 1){
+    reward = Q_FROM_INT(QL_REWARD_FAILURE);
+    // a busy cell means contention in this cell, a missing ACK may also be a weak link
+    if (outcome->mac_tx_status == MAC_TX_COLLISION){
+      reward -= QL_REWARD_COLLISION_PENALTY;
+    }
+    return reward;
+  }
+
+  reward = Q_FROM_INT(QL_REWARD_SUCCESS);
+  if (outcome->transmissions > 1){
+    reward -= QL_REWARD_RETRY_PENALTY * (outcome->transmissions - 1);
+  }
+  if (outcome->burst == 0){
+    reward -= Q_MUL(Q_FROM_FRACTION(outcome->queue_delay, UNICAST_SLOTFRAME_LENGTH), QL_REWARD_DELAY_PENALTY);
+  }
+  if (outcome->ack_rssi != 0 && outcome->ack_rssi < QL_REWARD_WEAK_ACK_RSSI){
+    reward -= QL_REWARD_WEAK_ACK_PENALTY;
+  }
+
+  // a late success is still better than a failure
+  if (reward < Q_FROM_INT(QL_REWARD_FAILURE)){
+    reward = Q_FROM_INT(QL_REWARD_FAILURE);
+  }
+  return reward;
+}
+
+// reward that also prefers cells where the Tx keeps the radio on for a short time
+q_value_t ql_reward_energy(const struct tsch_ql_tx_outcome *outcome)
+{
+  q_value_t reward = QL_REWARD_ENERGY_BASE(outcome);
+
+  reward -= Q_MUL(Q_FROM_FRACTION(outcome->radio_on, tsch_timing[tsch_ts_timeslot_length]),
+                  QL_REWARD_ENERGY_PENALTY);
+  if (outcome->status == 1 && reward < Q_FROM_INT(QL_REWARD_FAILURE)){
+    reward = Q_FROM_INT(QL_REWARD_FAILURE);
+  }
+  return reward;
+}
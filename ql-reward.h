@@ -0,0 +1,103 @@
+#ifndef QL_REWARD_H_
+#define QL_REWARD_H_
+
+/********** Libraries ***********/
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "ql-fixed-point.h"
+
+/********** Configuration ***********/
+
+// reward of a plain success and of a failure (the original binary reward)
+#ifdef QL_REWARD_SUCCESS_CONF
+#define QL_REWARD_SUCCESS QL_REWARD_SUCCESS_CONF
+#else
+#define QL_REWARD_SUCCESS 1
+#endif
+
+#ifdef QL_REWARD_FAILURE_CONF
+#define QL_REWARD_FAILURE QL_REWARD_FAILURE_CONF
+#else
+#define QL_REWARD_FAILURE 0
+#endif
+
+// ql_reward_latency: penalty per retransmission of a packet
+#ifdef QL_REWARD_RETRY_PENALTY_CONF
+#define QL_REWARD_RETRY_PENALTY QL_REWARD_RETRY_PENALTY_CONF
+#else
+#define QL_REWARD_RETRY_PENALTY Q_FROM_FLOAT(0.2)
+#endif
+
+// ql_reward_latency: penalty per unicast slotframe a packet waited in the queue (not charged to the
+// continuation frames of a burst, they waited for the frames before them, not for the cell)
+#ifdef QL_REWARD_DELAY_PENALTY_CONF
+#define QL_REWARD_DELAY_PENALTY QL_REWARD_DELAY_PENALTY_CONF
+#else
+#define QL_REWARD_DELAY_PENALTY Q_FROM_FLOAT(0.1)
+#endif
+
+// ql_reward_latency: extra penalty when the cell was busy (CCA) rather than the ACK missing
+#ifdef QL_REWARD_COLLISION_PENALTY_CONF
+#define QL_REWARD_COLLISION_PENALTY QL_REWARD_COLLISION_PENALTY_CONF
+#else
+#define QL_REWARD_COLLISION_PENALTY Q_FROM_FLOAT(0.5)
+#endif
+
+// ql_reward_latency: penalty for a success whose ACK was weaker than this RSSI (dBm)
+#ifdef QL_REWARD_WEAK_ACK_RSSI_CONF
+#define QL_REWARD_WEAK_ACK_RSSI QL_REWARD_WEAK_ACK_RSSI_CONF
+#else
+#define QL_REWARD_WEAK_ACK_RSSI -85
+#endif
+
+#ifdef QL_REWARD_WEAK_ACK_PENALTY_CONF
+#define QL_REWARD_WEAK_ACK_PENALTY QL_REWARD_WEAK_ACK_PENALTY_CONF
+#else
+#define QL_REWARD_WEAK_ACK_PENALTY Q_FROM_FLOAT(0.1)
+#endif
+
+// ql_reward_energy: the reward it reduces by the energy term
+#ifdef QL_REWARD_ENERGY_BASE_CONF
+#define QL_REWARD_ENERGY_BASE QL_REWARD_ENERGY_BASE_CONF
+#else
+#define QL_REWARD_ENERGY_BASE ql_reward_latency
+#endif
+
+// ql_reward_energy: penalty per timeslot length the radio was on for the Tx (frame and ACK wait)
+#ifdef QL_REWARD_ENERGY_PENALTY_CONF
+#define QL_REWARD_ENERGY_PENALTY QL_REWARD_ENERGY_PENALTY_CONF
+#else
+#define QL_REWARD_ENERGY_PENALTY Q_FROM_FLOAT(0.5)
+#endif
+
+// the reward function in use, any function of type ql_reward_function_t
+#ifdef QL_REWARD_FUNCTION_CONF
+#define QL_REWARD_FUNCTION QL_REWARD_FUNCTION_CONF
+#else
+#define QL_REWARD_FUNCTION ql_reward_binary
+#endif
+
+/********** Data types ***********/
+
+// maps the outcome of a Tx in a cell to the reward of that cell
+typedef q_value_t (* ql_reward_function_t)(const struct tsch_ql_tx_outcome *outcome);
+
+/********** Functions ***********/
+
+// the original reward: success or failure only
+q_value_t ql_reward_binary(const struct tsch_ql_tx_outcome *outcome);
+
+// success reward reduced by retransmissions, queueing delay and a weak ACK,
+// failure reward reduced further when the cell was found busy
+q_value_t ql_reward_latency(const struct tsch_ql_tx_outcome *outcome);
+
+// QL_REWARD_ENERGY_BASE reduced by the radio-on time of the Tx, so that cells with long
+// ACK waits and retries score worse (a success still scores above a failure)
+q_value_t ql_reward_energy(const struct tsch_ql_tx_outcome *outcome);
+
+// a user reward function set through QL_REWARD_FUNCTION_CONF
+#ifdef QL_REWARD_FUNCTION_CONF
+q_value_t QL_REWARD_FUNCTION_CONF(const struct tsch_ql_tx_outcome *outcome);
+#endif
+
+#endif /* QL_REWARD_H_ */
@@ -0,0 +1,95 @@
+/* Tournament tree index (tsch-ql-index) against the linear argmax scan it replaced,
+ * for the 15-slot slotframe of project-conf.h and for longer slotframes */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-index.h"
+#include "cycles.h"
+
+#define STEPS 200000
+
+/* values of the entries, Q16.16 like the Q-table */
+static int32_t values[397];
+
+static int compare(uint16_t a, uint16_t b)
+{
+  return (values[a] > values[b]) - (values[a] < values[b]);
+}
+
+TSCH_QL_INDEX(index_15, 15, compare);
+TSCH_QL_INDEX(index_101, 101, compare);
+TSCH_QL_INDEX(index_199, 199, compare);
+TSCH_QL_INDEX(index_397, 397, compare);
+
+/* the scan of the original code: highest value, ties broken by reservoir sampling */
+static uint16_t linear_best(uint16_t size)
+{
+  uint16_t best = 0;
+  uint16_t ties = 1;
+  for (uint16_t i = 1; i < size; i++){
+    if (values[i] > values[best]){
+      best = i;
+      ties = 1;
+    } else if (values[i] == values[best] && random_rand() % ++ties == 0){
+      best = i;
+    }
+  }
+  return best;
+}
+
+/* a Q-value update: one entry moves by a small step */
+static void change(uint16_t entry)
+{
+  values[entry] += (random_rand() % 2 ? 1 : -1) * (random_rand() % 4096);
+}
+
+/* one update and one argmax per step, as a Tx outcome followed by a selection */
+static void run(struct tsch_ql_index *idx)
+{
+  uint16_t size = idx->size;
+  uint64_t start;
+  double tree, linear;
+  volatile uint16_t sink = 0;
+
+  random_init(size);
+  for (uint16_t i = 0; i < size; i++){
+    values[i] = 0;
+  }
+  tsch_ql_index_init(idx);
+  start = cycles_now();
+  for (int s = 0; s < STEPS; s++){
+    uint16_t entry = random_rand() % size;
+    change(entry);
+    tsch_ql_index_update(idx, entry);
+    sink += tsch_ql_index_best(idx);
+  }
+  tree = (double)(cycles_now() - start) / STEPS;
+
+  random_init(size);
+  for (uint16_t i = 0; i < size; i++){
+    values[i] = 0;
+  }
+  start = cycles_now();
+  for (int s = 0; s < STEPS; s++){
+    uint16_t entry = random_rand() % size;
+    change(entry);
+    sink += linear_best(size);
+  }
+  linear = (double)(cycles_now() - start) / STEPS;
+
+  printf("%4u entries: tree %7.1f, linear scan %7.1f " CYCLES_UNIT " per update + argmax (%.1fx)\n",
+         size, tree, linear, linear / tree);
+  (void)sink;
+}
+
+int main(void)
+{
+  run(&index_15);
+  run(&index_101);
+  run(&index_199);
+  run(&index_397);
+  return 0;
+}
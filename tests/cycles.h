@@ -0,0 +1,22 @@
+/* Cycle counter of the host CPU, or nanoseconds where there is none */
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES_UNIT "cycles"
+static inline uint64_t cycles_now(void) { return __rdtsc(); }
+#else
+#include <time.h>
+#define CYCLES_UNIT "ns"
+static inline uint64_t cycles_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+
+#endif /* CYCLES_H_ */
@@ -0,0 +1,11 @@
+/* Host stand-in for contiki.h: just enough for the QL-TSCH modules built by the tests */
+#ifndef CONTIKI_H_
+#define CONTIKI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CC_CONCAT2(s1, s2) s1##s2
+#define CC_CONCAT(s1, s2) CC_CONCAT2(s1, s2)
+
+#endif /* CONTIKI_H_ */
@@ -0,0 +1,12 @@
+/* Host stand-in for lib/random.h */
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stdlib.h>
+
+#define RANDOM_RAND_MAX 65535U
+
+static inline unsigned short random_rand(void) { return rand() & RANDOM_RAND_MAX; }
+static inline void random_init(unsigned short seed) { srand(seed); }
+
+#endif /* RANDOM_H_ */
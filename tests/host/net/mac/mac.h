@@ -0,0 +1,15 @@
+/* Host stand-in for net/mac/mac.h: the Tx status codes the rewards look at */
+#ifndef MAC_H_
+#define MAC_H_
+
+enum {
+  MAC_TX_OK,
+  MAC_TX_COLLISION,
+  MAC_TX_NOACK,
+  MAC_TX_DEFERRED,
+  MAC_TX_ERR,
+  MAC_TX_ERR_FATAL,
+  MAC_TX_QUEUE_FULL,
+};
+
+#endif /* MAC_H_ */
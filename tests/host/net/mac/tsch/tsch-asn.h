@@ -0,0 +1,46 @@
+/* Host stand-in for net/mac/tsch/tsch-asn.h: the 40-bit ASN and its macros, as in Contiki-NG */
+#ifndef TSCH_ASN_H_
+#define TSCH_ASN_H_
+
+#include "contiki.h"
+
+struct tsch_asn_t {
+  uint32_t ls4b;
+  uint8_t ms1b;
+};
+
+struct tsch_asn_divisor_t {
+  uint16_t val;
+  uint16_t asn_ms1b_remainder;
+};
+
+#define TSCH_ASN_INIT(asn, ms1b_, ls4b_) do { \
+    (asn).ms1b = (ms1b_); \
+    (asn).ls4b = (ls4b_); \
+} while(0);
+
+#define TSCH_ASN_INC(asn, inc) do { \
+    uint32_t new_ls4b = (asn).ls4b + (inc); \
+    if(new_ls4b < (asn).ls4b) { (asn).ms1b++; } \
+    (asn).ls4b = new_ls4b; \
+} while(0);
+
+#define TSCH_ASN_DEC(asn, dec) do { \
+    uint32_t new_ls4b = (asn).ls4b - (dec); \
+    if(new_ls4b > (asn).ls4b) { (asn).ms1b--; } \
+    (asn).ls4b = new_ls4b; \
+} while(0);
+
+#define TSCH_ASN_DIFF(asn1, asn2) \
+  ((asn1).ls4b - (asn2).ls4b)
+
+#define TSCH_ASN_DIVISOR_INIT(div, val_) \
+  (div).val = (val_); \
+  (div).asn_ms1b_remainder = ((0xffffffff % (val_)) + 1) % (val_);
+
+#define TSCH_ASN_MOD(asn, div) \
+  ((uint16_t)((asn).ls4b % (div).val) \
+   + (uint16_t)((asn).ms1b * (div).asn_ms1b_remainder % (div).val)) \
+  % (div).val
+
+#endif /* TSCH_ASN_H_ */
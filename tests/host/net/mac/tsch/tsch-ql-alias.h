@@ -0,0 +1,2 @@
+/* The alias table header of the tree, under its Contiki-NG include path */
+#include "../../../../../tsch/tsch-ql-alias.h"
@@ -0,0 +1,3 @@
+/* The ASN cursor header of the tree, under its Contiki-NG include path */
+#include "tsch-asn.h"
+#include "../../../../../tsch/tsch-ql-asn.h"
@@ -0,0 +1,2 @@
+/* The index header of the tree, under its Contiki-NG include path */
+#include "../../../../../tsch/tsch-ql-index.h"
@@ -0,0 +1,54 @@
+/* Host stand-in for net/mac/tsch/tsch.h: the QL-TSCH cells of the unicast slotframe and the
+ * APT queries the learners call, for building the learners without Contiki */
+#ifndef TSCH_H_
+#define TSCH_H_
+
+#include "contiki.h"
+
+#define QL_TSCH_ENABLED 1
+
+/* the 15 timeslots of the unicast slotframe of project-conf.h, one channel offset */
+#ifndef UNICAST_SLOTFRAME_LENGTH
+#define UNICAST_SLOTFRAME_LENGTH 15
+#endif
+#ifndef QL_NUM_CHANNEL_OFFSETS
+#define QL_NUM_CHANNEL_OFFSETS 1
+#endif
+
+#define QL_NUM_ACTIONS (UNICAST_SLOTFRAME_LENGTH * QL_NUM_CHANNEL_OFFSETS)
+#define QL_ACTION(timeslot, channel_offset) ((channel_offset) * UNICAST_SLOTFRAME_LENGTH + (timeslot))
+#define QL_ACTION_TIMESLOT(action) ((action) % UNICAST_SLOTFRAME_LENGTH)
+#define QL_ACTION_CHANNEL_OFFSET(action) ((action) / UNICAST_SLOTFRAME_LENGTH)
+
+#include "net/mac/tsch/tsch-asn.h"
+#include "net/mac/tsch/tsch-ql-index.h"
+
+/* as tsch/tsch-slot-operation.h */
+struct tsch_ql_tx_outcome {
+  struct tsch_asn_t asn;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint8_t status;
+  uint8_t mac_tx_status;
+  uint8_t transmissions;
+  uint8_t last_tx;
+  int8_t ack_rssi;
+  uint8_t ack_lqi;
+  uint16_t queue_delay;
+  uint16_t radio_on;
+  uint8_t burst;
+};
+
+/* the timeslot timing, read by the energy reward */
+enum tsch_timeslot_timing_elements {
+  tsch_ts_timeslot_length,
+  tsch_ts_elements_count,
+};
+extern uint16_t tsch_timing[tsch_ts_elements_count];
+
+/* the APT queries of the exploration */
+uint16_t get_slot_with_apt_table_min_value(void);
+uint16_t get_slot_with_apt_table_min_value_excluding(const uint8_t *excluded);
+uint16_t get_slot_with_apt_table_weighted(const uint8_t *excluded);
+
+#endif /* TSCH_H_ */
@@ -0,0 +1,106 @@
+/* The QL-TSCH learner (ql-learner-ql-tsch.c with ql-exploration.c, ql-reward.c and the
+ * tournament index) on a trace of Tx outcomes, driven through its ql_learner interface.
+ * Built once with float and once with Q16.16 Q-values (QL_FIXED_POINT_CONF); only the
+ * entry points, suffixed with QL_REPLAY_SUFFIX, are left global in the linked object */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch.h"
+#include "ql-learner.h"
+#include "ql-reward.h"
+#include "ql-replay.h"
+#include "cycles.h"
+
+#define QL_REPLAY_FN(name) CC_CONCAT(name, QL_REPLAY_SUFFIX)
+
+/* 10 ms timeslots at 32768 rtimer ticks per second */
+uint16_t tsch_timing[tsch_ts_elements_count] = { 328 };
+
+/* the replayed node hears no neighbours, so all timeslots are equally free to explore */
+uint16_t get_slot_with_apt_table_min_value(void)
+{
+  return random_rand() % UNICAST_SLOTFRAME_LENGTH;
+}
+
+uint16_t get_slot_with_apt_table_min_value_excluding(const uint8_t *excluded)
+{
+  return get_slot_with_apt_table_min_value();
+}
+
+uint16_t get_slot_with_apt_table_weighted(const uint8_t *excluded)
+{
+  return get_slot_with_apt_table_min_value();
+}
+
+/* reward of a step, through the reward function of the node */
+static q_value_t reward(const struct ql_trace_step *step)
+{
+  struct tsch_ql_tx_outcome outcome;
+  memset(&outcome, 0, sizeof(outcome));
+  outcome.timeslot = step->action;
+  outcome.status = step->success ? 1 : 2;
+  outcome.transmissions = 1;
+  return QL_REWARD_FUNCTION(&outcome);
+}
+
+/* highest Q-value, the lowest action wins a tie; gap is the distance to the runner-up.
+ * The learner breaks ties at random, the scan keeps the two arithmetics comparable */
+static uint16_t greedy(double *gap)
+{
+  uint16_t best = 0;
+  uint16_t second = 1;
+  for (uint16_t a = 1; a < REPLAY_NUM_ACTIONS; a++){
+    if (ql_learner_ql_tsch.value(a) > ql_learner_ql_tsch.value(best)){
+      second = best;
+      best = a;
+    } else if (a != best && (second == best || ql_learner_ql_tsch.value(a) > ql_learner_ql_tsch.value(second))){
+      second = a;
+    }
+  }
+  *gap = ((double)ql_learner_ql_tsch.value(best) - (double)ql_learner_ql_tsch.value(second)) / (double)Q_ONE;
+  return best;
+}
+
+/* run the learner against cells with the given success rates and record its Tx */
+void QL_REPLAY_FN(ql_trace_record)(struct ql_trace_step *trace, int len, const double *success_rate,
+                                   unsigned seed)
+{
+  struct ql_learner_context ctx = { 0, 0, NULL };
+  random_init(seed);
+  ql_learner_ql_tsch.init();
+  for (int i = 0; i < len; i++){
+    ctx.cycles = i;
+    ql_learner_ql_tsch.select(&ctx, &trace[i].action, 1);
+    trace[i].success = (double)rand() / RAND_MAX < success_rate[trace[i].action];
+    ql_learner_ql_tsch.update(&ctx, trace[i].action, reward(&trace[i]));
+  }
+}
+
+/* replay a trace, writing the greedy action and the gap to the runner-up after every step */
+void QL_REPLAY_FN(ql_trace_replay)(const struct ql_trace_step *trace, int len, uint16_t *actions, double *gaps)
+{
+  struct ql_learner_context ctx = { 0, 0, NULL };
+  ql_learner_ql_tsch.init();
+  for (int i = 0; i < len; i++){
+    ctx.cycles = i;
+    ql_learner_ql_tsch.update(&ctx, trace[i].action, reward(&trace[i]));
+    actions[i] = greedy(&gaps[i]);
+  }
+}
+
+/* cost of an update of the learner (Q-value and index), per step of the trace */
+double QL_REPLAY_FN(ql_trace_update_cycles)(const struct ql_trace_step *trace, int len)
+{
+  struct ql_learner_context ctx = { 0, 0, NULL };
+  q_value_t rewards[2] = { Q_FROM_INT(QL_REWARD_FAILURE), Q_FROM_INT(QL_REWARD_SUCCESS) };
+  uint64_t start;
+  ql_learner_ql_tsch.init();
+  start = cycles_now();
+  for (int i = 0; i < len; i++){
+    ql_learner_ql_tsch.update(&ctx, trace[i].action, rewards[trace[i].success]);
+  }
+  return (double)(cycles_now() - start) / len;
+}
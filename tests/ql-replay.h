@@ -0,0 +1,21 @@
+/* The QL-TSCH learner replayed on a trace of Tx outcomes, in float and in Q16.16 */
+#ifndef QL_REPLAY_H_
+#define QL_REPLAY_H_
+
+#include <stdint.h>
+
+/* the actions of the host tsch.h: 15 timeslots, one channel offset */
+#define REPLAY_NUM_ACTIONS 15
+
+struct ql_trace_step {
+  uint16_t action;
+  uint8_t success;
+};
+
+void ql_trace_record_float(struct ql_trace_step *trace, int len, const double *success_rate, unsigned seed);
+void ql_trace_replay_float(const struct ql_trace_step *trace, int len, uint16_t *actions, double *gaps);
+void ql_trace_replay_fixed(const struct ql_trace_step *trace, int len, uint16_t *actions, double *gaps);
+double ql_trace_update_cycles_float(const struct ql_trace_step *trace, int len);
+double ql_trace_update_cycles_fixed(const struct ql_trace_step *trace, int len);
+
+#endif /* QL_REPLAY_H_ */
@@ -0,0 +1,110 @@
+/* Alias table (tsch-ql-alias): the frequencies of the draws must follow the weights and
+ * an entry of weight 0 must never be drawn */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-alias.h"
+
+#define DRAWS 300000
+#define MAX_ENTRIES 101
+
+TSCH_QL_ALIAS(alias_15, 15);
+TSCH_QL_ALIAS(alias_101, 101);
+
+static uint16_t weights[MAX_ENTRIES];
+
+/* draw from the table built over the weights, chi-square of the drawn frequencies */
+static int check(struct tsch_ql_alias *table, const char *name)
+{
+  uint32_t counts[MAX_ENTRIES] = { 0 };
+  uint32_t total = 0;
+  uint16_t nonzero = 0;            /* entries in the chi-square */
+  double chi2 = 0;
+  double limit;
+  int ok = 1;
+
+  for (uint16_t i = 0; i < table->size; i++){
+    total += weights[i];
+  }
+  if (tsch_ql_alias_build(table, weights) != total){
+    printf("%s: wrong total\n", name);
+    return 0;
+  }
+  for (int d = 0; d < DRAWS; d++){
+    counts[tsch_ql_alias_draw(table)]++;
+  }
+  for (uint16_t i = 0; i < table->size; i++){
+    double expected = (double)DRAWS * weights[i] / total;
+    if (weights[i] == 0){
+      if (counts[i] != 0){
+        printf("%s: entry %u of weight 0 drawn %u times\n", name, i, counts[i]);
+        ok = 0;
+      }
+      continue;
+    }
+    /* the chi-square approximation needs a few expected draws per entry */
+    if (expected < 5){
+      continue;
+    }
+    nonzero++;
+    chi2 += (counts[i] - expected) * (counts[i] - expected) / expected;
+  }
+  /* 0.999 quantile of chi-square, Wilson-Hilferty approximation */
+  if (nonzero > 1){
+    double k = nonzero - 1;
+    double z = 3.09;
+    limit = k * pow(1 - 2 / (9 * k) + z * sqrt(2 / (9 * k)), 3);
+    printf("%s: %u entries tested, chi-square %.1f (limit %.1f)\n", name, nonzero, chi2, limit);
+    ok &= chi2 < limit;
+  } else {
+    printf("%s: %u entry tested\n", name, nonzero);
+  }
+  return ok;
+}
+
+int main(void)
+{
+  int ok = 1;
+
+  random_init(1);
+  /* uniform */
+  for (uint16_t i = 0; i < 15; i++){
+    weights[i] = 100;
+  }
+  ok &= check(&alias_15, "uniform");
+  /* skewed, with zero weights at both ends and in the middle */
+  for (uint16_t i = 0; i < 15; i++){
+    weights[i] = (i == 0 || i == 7 || i == 14) ? 0 : i * i;
+  }
+  ok &= check(&alias_15, "skewed");
+  /* one entry only */
+  for (uint16_t i = 0; i < 15; i++){
+    weights[i] = i == 9 ? 1 : 0;
+  }
+  ok &= check(&alias_15, "single");
+  /* extreme weights */
+  for (uint16_t i = 0; i < 15; i++){
+    weights[i] = i % 2 ? 65535 : 1;
+  }
+  ok &= check(&alias_15, "extreme");
+  /* random weights, a third of them 0 */
+  for (uint16_t i = 0; i < 101; i++){
+    weights[i] = random_rand() % 3 == 0 ? 0 : random_rand() % 1000;
+  }
+  ok &= check(&alias_101, "random");
+  /* all zero: nothing to draw from */
+  for (uint16_t i = 0; i < 15; i++){
+    weights[i] = 0;
+  }
+  if (tsch_ql_alias_build(&alias_15, weights) != 0){
+    printf("empty: non-zero total\n");
+    ok = 0;
+  }
+
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return !ok;
+}
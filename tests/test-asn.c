@@ -0,0 +1,89 @@
+/* ASN modulo cursor (tsch-ql-asn) against the plain 40-bit modulo: steps within a slot,
+ * jumps over many slotframes, carries into and wraps of the ms1b, jumps back and divisor
+ * changes, for power-of-two and other divisors */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-asn.h"
+
+#define STEPS 200000
+
+static const uint16_t divisors[] = { 1, 2, 7, 15, 16, 101, 397, 1024, 40000, 65535 };
+#define NUM_DIVISORS (sizeof(divisors) / sizeof(divisors[0]))
+
+/* the ASN as a 40-bit number */
+static uint64_t asn_value(const struct tsch_asn_t *asn)
+{
+  return ((uint64_t)asn->ms1b << 32) | asn->ls4b;
+}
+
+static uint32_t random32(void)
+{
+  return ((uint32_t)random_rand() << 16) | random_rand();
+}
+
+/* how far the ASN moves in a step, mostly as the slot operation moves it */
+static void step(struct tsch_asn_t *asn)
+{
+  uint16_t kind = random_rand() % 100;
+  if (kind < 80){
+    TSCH_ASN_INC(*asn, 1 + random_rand() % 16);
+  } else if (kind < 95){
+    TSCH_ASN_INC(*asn, random32() >> (random_rand() % 32));
+  } else if (kind < 98){
+    /* resynchronization or association back in time */
+    TSCH_ASN_DEC(*asn, random32() >> (random_rand() % 32));
+  } else {
+    /* close to a carry into the ms1b, or to the end of the 40 bits */
+    TSCH_ASN_INIT(*asn, random_rand() % 2 ? 0xff : random_rand() & 0xff, 0xffffffff - random_rand() % 64);
+  }
+}
+
+/* one cursor per divisor, all following the same ASN walk */
+static int walk(unsigned seed)
+{
+  struct tsch_ql_asn_cursor cursors[NUM_DIVISORS] = { { { 0, 0 }, 0, 0 } };
+  struct tsch_asn_divisor_t div[NUM_DIVISORS];
+  struct tsch_asn_t asn;
+
+  random_init(seed);
+  for (unsigned d = 0; d < NUM_DIVISORS; d++){
+    TSCH_ASN_DIVISOR_INIT(div[d], divisors[d]);
+  }
+  TSCH_ASN_INIT(asn, 0, 0);
+  for (int s = 0; s < STEPS; s++){
+    unsigned d = random_rand() % NUM_DIVISORS;
+    uint16_t expected = asn_value(&asn) % div[d].val;
+    uint16_t got = tsch_ql_asn_mod(&cursors[d], &asn, &div[d]);
+    if (got != expected){
+      printf("seed %u step %d: ASN 0x%02x%08lx mod %u = %u, cursor %u\n", seed, s, asn.ms1b,
+             (unsigned long)asn.ls4b, div[d].val, expected, got);
+      return 0;
+    }
+    /* now and then a cursor is moved to another divisor */
+    if (random_rand() % 1000 == 0){
+      unsigned other = random_rand() % NUM_DIVISORS;
+      expected = asn_value(&asn) % div[other].val;
+      if (tsch_ql_asn_mod(&cursors[d], &asn, &div[other]) != expected){
+        printf("seed %u step %d: cursor wrong after a divisor change to %u\n", seed, s, div[other].val);
+        return 0;
+      }
+    }
+    step(&asn);
+  }
+  return 1;
+}
+
+int main(void)
+{
+  int ok = 1;
+  for (unsigned seed = 1; seed <= 5; seed++){
+    ok &= walk(seed);
+  }
+  printf("%d steps x 5 walks over %u divisors\n", STEPS, (unsigned)NUM_DIVISORS);
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return !ok;
+}
@@ -0,0 +1,115 @@
+/* Exploration schedules (ql-exploration.c), built with float and with Q16.16 values:
+ * the values of the schedules at known points, their bounds and monotony, the adaptive
+ * schedule under Tx feedback, and the frequency of ql_exploration_explore() */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "ql-exploration.h"
+
+#define DRAWS 200000
+/* q_exp of the fixed-point build approximates 2^f within about 0.3 % */
+#define TOLERANCE 0.005
+
+static int failed = 0;
+
+static double value(q_value_t x)
+{
+  return (double)x / (double)Q_ONE;
+}
+
+static void expect(const char *what, uint32_t cycles, double got, double expected)
+{
+  if (fabs(got - expected) > TOLERANCE * (expected > 1 ? expected : 1)){
+    printf("%s at %lu cycles: %f, expected %f\n", what, (unsigned long)cycles, got, expected);
+    failed = 1;
+  }
+}
+
+/* never above QL_EPSILON, never below QL_EPSILON_MIN, never going up */
+static void check_decay(const char *what, ql_exploration_schedule_t schedule, uint32_t last)
+{
+  q_value_t previous = schedule(0);
+  for (uint32_t cycles = 0; cycles <= last; cycles += 7){
+    q_value_t epsilon = schedule(cycles);
+    if (epsilon > QL_EPSILON || epsilon < QL_EPSILON_MIN || epsilon > previous){
+      printf("%s at %lu cycles: %f after %f\n", what, (unsigned long)cycles, value(epsilon), value(previous));
+      failed = 1;
+      return;
+    }
+    previous = epsilon;
+  }
+}
+
+int main(void)
+{
+  double eps = value(QL_EPSILON);
+  double eps_min = value(QL_EPSILON_MIN);
+  uint32_t k = QL_EXPLORATION_INVERSE_TIME_K;
+  uint32_t half_life = QL_EXPLORATION_HALF_LIFE;
+  uint32_t linear = QL_EXPLORATION_LINEAR_CYCLES;
+
+  /* min(QL_EPSILON, K / cycles) */
+  expect("inverse time", 0, value(ql_exploration_inverse_time(0)), eps);
+  expect("inverse time", k, value(ql_exploration_inverse_time(k)), eps);
+  expect("inverse time", 4 * k, value(ql_exploration_inverse_time(4 * k)), fmax(fmin(eps, 0.25), eps_min));
+  expect("inverse time", 1000 * k, value(ql_exploration_inverse_time(1000 * k)), fmax(fmin(eps, 0.001), eps_min));
+  check_decay("inverse time", ql_exploration_inverse_time, 20 * k);
+
+  /* halves every half life */
+  expect("exponential", 0, value(ql_exploration_exponential(0)), eps);
+  expect("exponential", half_life / 2, value(ql_exploration_exponential(half_life / 2)), fmax(eps / sqrt(2), eps_min));
+  expect("exponential", half_life, value(ql_exploration_exponential(half_life)), fmax(eps / 2, eps_min));
+  expect("exponential", 3 * half_life, value(ql_exploration_exponential(3 * half_life)), fmax(eps / 8, eps_min));
+  expect("exponential", 40 * half_life, value(ql_exploration_exponential(40 * half_life)), eps_min);
+  check_decay("exponential", ql_exploration_exponential, 40 * half_life);
+
+  /* a straight line down to QL_EPSILON_MIN */
+  expect("linear", 0, value(ql_exploration_linear(0)), eps);
+  expect("linear", linear / 4, value(ql_exploration_linear(linear / 4)), eps - (eps - eps_min) / 4);
+  expect("linear", linear, value(ql_exploration_linear(linear)), eps_min);
+  expect("linear", 2 * linear, value(ql_exploration_linear(2 * linear)), eps_min);
+  check_decay("linear", ql_exploration_linear, 2 * linear);
+
+  /* the success rate starts at 0, goes up with successful slotframes and down with failed ones */
+  expect("adaptive, no feedback", 0, value(ql_exploration_adaptive(0)), eps);
+  for (int i = 0; i < 400; i++){
+    ql_exploration_feedback(10, 0);
+  }
+  expect("adaptive, all Tx ok", 0, value(ql_exploration_adaptive(0)), eps_min);
+  for (int i = 0; i < 400; i++){
+    ql_exploration_feedback(1, 1);
+  }
+  expect("adaptive, half the Tx ok", 0, value(ql_exploration_adaptive(0)), eps_min + (eps - eps_min) / 2);
+  for (int i = 0; i < 400; i++){
+    ql_exploration_feedback(0, 0);
+  }
+  expect("adaptive, idle", 0, value(ql_exploration_adaptive(0)), eps_min + (eps - eps_min) / 2);
+  for (int i = 0; i < 400; i++){
+    ql_exploration_feedback(0, 3);
+  }
+  expect("adaptive, all Tx failed", 0, value(ql_exploration_adaptive(0)), eps);
+
+  /* ql_exploration_explore() follows the schedule in use */
+  ql_exploration_set_schedule(ql_exploration_linear);
+  random_init(1);
+  for (uint32_t cycles = 0; cycles <= linear; cycles += linear / 4){
+    double epsilon = value(ql_exploration_epsilon(cycles));
+    uint32_t explored = 0;
+    double sigma = sqrt(DRAWS * epsilon * (1 - epsilon));
+    for (int d = 0; d < DRAWS; d++){
+      explored += ql_exploration_explore(cycles);
+    }
+    if (fabs(explored - DRAWS * epsilon) > 4 * sigma + 1){
+      printf("explore at %lu cycles: %lu of %d draws, epsilon %f\n", (unsigned long)cycles,
+             (unsigned long)explored, DRAWS, epsilon);
+      failed = 1;
+    }
+  }
+
+  printf("schedules with %s values checked\n", QL_FIXED_POINT ? "Q16.16" : "float");
+  printf(failed ? "FAIL\n" : "PASS\n");
+  return failed;
+}
@@ -0,0 +1,62 @@
+/* Q16.16 against float: the greedy actions of the QL-TSCH learner must agree on recorded
+ * traces, except where the two best Q-values are closer than the fixed-point resolution */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ql-replay.h"
+#include "cycles.h"
+
+#define TRACE_LEN 50000
+/* decisions closer than this are ties that either arithmetic may break its own way */
+#define TIE_GAP 1e-3
+
+/* success rates of the cells in the recorded scenarios */
+static const double scenarios[][REPLAY_NUM_ACTIONS] = {
+  /* one clearly good cell */
+  { 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.9, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2 },
+  /* two close cells */
+  { 0.5, 0.5, 0.5, 0.85, 0.5, 0.5, 0.5, 0.5, 0.5, 0.8, 0.5, 0.5, 0.5, 0.5, 0.5 },
+  /* lossy network */
+  { 0.1, 0.3, 0.2, 0.1, 0.4, 0.1, 0.2, 0.3, 0.1, 0.2, 0.35, 0.1, 0.2, 0.1, 0.3 },
+  /* every cell works */
+  { 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95, 0.95 },
+};
+
+static struct ql_trace_step trace[TRACE_LEN];
+static uint16_t float_actions[TRACE_LEN], fixed_actions[TRACE_LEN];
+static double float_gaps[TRACE_LEN], fixed_gaps[TRACE_LEN];
+
+int main(void)
+{
+  int failed = 0;
+
+  for (unsigned s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++){
+    int mismatches = 0, ties = 0;
+
+    ql_trace_record_float(trace, TRACE_LEN, scenarios[s], 1 + s);
+    ql_trace_replay_float(trace, TRACE_LEN, float_actions, float_gaps);
+    ql_trace_replay_fixed(trace, TRACE_LEN, fixed_actions, fixed_gaps);
+    for (int i = 0; i < TRACE_LEN; i++){
+      if (float_actions[i] == fixed_actions[i]){
+        continue;
+      }
+      if (float_gaps[i] < TIE_GAP || fixed_gaps[i] < TIE_GAP){
+        ties++;
+      } else {
+        mismatches++;
+      }
+    }
+    printf("scenario %u: %d steps, %d near-tie differences, %d mismatches, final action %u/%u\n",
+           s, TRACE_LEN, ties, mismatches, float_actions[TRACE_LEN - 1], fixed_actions[TRACE_LEN - 1]);
+    if (mismatches > 0 || float_actions[TRACE_LEN - 1] != fixed_actions[TRACE_LEN - 1]){
+      failed = 1;
+    }
+  }
+
+  printf("Q-value update: float %.1f, Q16.16 %.1f " CYCLES_UNIT " per update (host)\n",
+         ql_trace_update_cycles_float(trace, TRACE_LEN), ql_trace_update_cycles_fixed(trace, TRACE_LEN));
+
+  printf(failed ? "FAIL\n" : "PASS\n");
+  return failed;
+}
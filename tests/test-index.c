@@ -0,0 +1,157 @@
+/* Tournament tree index (tsch-ql-index) against a linear scan: after random updates,
+ * exclusions and re-inclusions the argmax and argmin of the tree must hold the best value
+ * of the ranked entries, and a tie must be broken uniformly among the tied entries */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-index.h"
+
+#define STEPS 20000
+#define MAX_ENTRIES 101
+/* a few distinct values, so that ties are frequent */
+#define NUM_VALUES 6
+
+#define TIE_DRAWS 60000
+/* chi-square 0.999 quantiles for 1..4 degrees of freedom */
+static const double chi2_limit[] = { 0, 10.83, 13.82, 16.27, 18.47 };
+
+static int32_t values[MAX_ENTRIES];
+static uint8_t excluded[MAX_ENTRIES];
+
+static int compare_max(uint16_t a, uint16_t b)
+{
+  return (values[a] > values[b]) - (values[a] < values[b]);
+}
+
+static int compare_min(uint16_t a, uint16_t b)
+{
+  return compare_max(b, a);
+}
+
+TSCH_QL_INDEX(max_15, 15, compare_max);
+TSCH_QL_INDEX(min_15, 15, compare_min);
+TSCH_QL_INDEX(max_101, 101, compare_max);
+TSCH_QL_INDEX(min_101, 101, compare_min);
+
+/* best value among the ranked entries, by scanning them */
+static int32_t linear_best(uint16_t size, int sign)
+{
+  int found = 0;
+  int32_t best = 0;
+  for (uint16_t i = 0; i < size; i++){
+    if (!excluded[i] && (!found || sign * values[i] > sign * best)){
+      best = values[i];
+      found = 1;
+    }
+  }
+  return best;
+}
+
+/* peek and best must be ranked entries holding the value of the scan */
+static int check(const struct tsch_ql_index *idx, int sign)
+{
+  int32_t expected = linear_best(idx->size, sign);
+  uint16_t peek = tsch_ql_index_peek(idx);
+  uint16_t best = tsch_ql_index_best(idx);
+  return !excluded[peek] && !excluded[best] && values[peek] == expected && values[best] == expected;
+}
+
+/* random updates, exclusions and re-inclusions, checked against the scan after each */
+static int random_walk(struct tsch_ql_index *max, struct tsch_ql_index *min)
+{
+  uint16_t size = max->size;
+  uint16_t ranked = size;
+
+  random_init(size);
+  for (uint16_t i = 0; i < size; i++){
+    values[i] = random_rand() % NUM_VALUES;
+    excluded[i] = 0;
+  }
+  tsch_ql_index_init(max);
+  tsch_ql_index_init(min);
+  for (int s = 0; s < STEPS; s++){
+    uint16_t entry = random_rand() % size;
+    switch (random_rand() % 3){
+    case 0:
+      values[entry] = random_rand() % NUM_VALUES;
+      tsch_ql_index_update(max, entry);
+      tsch_ql_index_update(min, entry);
+      break;
+    case 1:
+      /* keep one entry ranked, an index with none has no best entry */
+      if (!excluded[entry] && ranked > 1){
+        excluded[entry] = 1;
+        ranked--;
+        tsch_ql_index_exclude(max, entry);
+        tsch_ql_index_exclude(min, entry);
+      }
+      break;
+    default:
+      if (excluded[entry]){
+        excluded[entry] = 0;
+        ranked++;
+        tsch_ql_index_include(max, entry);
+        tsch_ql_index_include(min, entry);
+      }
+      break;
+    }
+    if (!check(max, 1) || !check(min, -1)){
+      printf("%u entries: step %d, argmax %u/%u argmin %u/%u, scan %ld/%ld\n", size, s,
+             tsch_ql_index_peek(max), tsch_ql_index_best(max),
+             tsch_ql_index_peek(min), tsch_ql_index_best(min),
+             (long)linear_best(size, 1), (long)linear_best(size, -1));
+      return 0;
+    }
+  }
+  printf("%u entries: %d steps, argmax and argmin agree with the scan\n", size, STEPS);
+  return 1;
+}
+
+/* draw the best of an index with tied best entries, the first of them excluded, and test uniformity */
+static int tie_uniformity(struct tsch_ql_index *idx, int sign, const uint16_t *tied, uint16_t num_tied)
+{
+  uint32_t counts[MAX_ENTRIES] = { 0 };
+  double expected = (double)TIE_DRAWS / (num_tied - 1);
+  double chi2 = 0;
+
+  for (uint16_t i = 0; i < idx->size; i++){
+    values[i] = 7 - 7 * sign;
+    excluded[i] = 0;
+  }
+  for (uint16_t i = 0; i < num_tied; i++){
+    values[tied[i]] = 7;
+  }
+  tsch_ql_index_init(idx);
+  /* an excluded entry of the tie must never be drawn */
+  excluded[tied[0]] = 1;
+  tsch_ql_index_exclude(idx, tied[0]);
+
+  random_init(num_tied);
+  for (int d = 0; d < TIE_DRAWS; d++){
+    counts[tsch_ql_index_best(idx)]++;
+  }
+  for (uint16_t i = 1; i < num_tied; i++){
+    chi2 += (counts[tied[i]] - expected) * (counts[tied[i]] - expected) / expected;
+  }
+  printf("%u entries, %u tied: chi-square %.2f (limit %.2f), excluded drawn %u times\n",
+         idx->size, num_tied - 1, chi2, chi2_limit[num_tied - 2], counts[tied[0]]);
+  return counts[tied[0]] == 0 && chi2 < chi2_limit[num_tied - 2];
+}
+
+int main(void)
+{
+  static const uint16_t tied_15[] = { 4, 0, 5, 9, 14 };
+  static const uint16_t tied_101[] = { 50, 1, 64, 100 };
+  int ok = 1;
+
+  ok &= random_walk(&max_15, &min_15);
+  ok &= random_walk(&max_101, &min_101);
+  ok &= tie_uniformity(&max_15, 1, tied_15, sizeof(tied_15) / sizeof(tied_15[0]));
+  ok &= tie_uniformity(&min_101, -1, tied_101, sizeof(tied_101) / sizeof(tied_101[0]));
+
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return !ok;
+}
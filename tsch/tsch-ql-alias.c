@@ -0,0 +1,87 @@
+/**
+ * \file
+ *         Alias table (Vose's method). Every entry of the table is a column
+ *         holding at most two entries: the column itself with probability
+ *         prob/65536 and its alias for the rest. Building splits the weights
+ *         over the columns in O(N), a draw is one uniform column and one
+ *         biased coin.
+ */
+
+/**
+ * \addtogroup tsch
+ * @{
+*/
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-alias.h"
+
+/*---------------------------------------------------------------------------*/
+uint32_t
+tsch_ql_alias_build(struct tsch_ql_alias *table, const uint16_t *weights)
+{
+  uint16_t i;
+  uint16_t num_small = 0;           /* stack of the columns below the average, from the front of work */
+  uint16_t num_large = 0;           /* ... and above it, from the back */
+  uint16_t *small = table->work;
+  uint16_t *large = table->work + table->size;
+
+  table->total = 0;
+  for(i = 0; i < table->size; i++) {
+    table->total += weights[i];
+  }
+  if(table->total == 0) {
+    return 0;
+  }
+
+  /* Scale the weights so that the average column holds exactly `total` */
+  for(i = 0; i < table->size; i++) {
+    table->mass[i] = (uint32_t)weights[i] * table->size;
+    if(table->mass[i] < table->total) {
+      small[num_small++] = i;
+    } else {
+      *--large = i;
+      num_large++;
+    }
+  }
+
+  /* Fill every small column up with a large one */
+  while(num_small > 0 && num_large > 0) {
+    uint16_t s = small[--num_small];
+    uint16_t l = *large++;
+    num_large--;
+
+    table->prob[s] = (uint16_t)(((uint64_t)table->mass[s] << 16) / table->total);
+    table->alias[s] = l;
+    table->mass[l] -= table->total - table->mass[s];
+    if(table->mass[l] < table->total) {
+      small[num_small++] = l;
+    } else {
+      *--large = l;
+      num_large++;
+    }
+  }
+
+  /* What is left is full, up to rounding */
+  while(num_small > 0) {
+    i = small[--num_small];
+    table->prob[i] = 0xffff;
+    table->alias[i] = i;
+  }
+  while(num_large > 0) {
+    i = *large++;
+    num_large--;
+    table->prob[i] = 0xffff;
+    table->alias[i] = i;
+  }
+  return table->total;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tsch_ql_alias_draw(const struct tsch_ql_alias *table)
+{
+  uint16_t column = random_rand() % table->size;
+  return (uint16_t)random_rand() < table->prob[column] ? column : table->alias[column];
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
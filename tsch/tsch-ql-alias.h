@@ -0,0 +1,57 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	Alias table (Vose's method) to draw entries with given weights in O(1),
+ *	used by QL-TSCH to spread exploration over the less occupied timeslots
+*/
+
+#ifndef __TSCH_QL_ALIAS_H__
+#define __TSCH_QL_ALIAS_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+
+/********** Data types **********/
+
+/* An alias table over `size` entries. A draw picks a column uniformly and
+ * keeps it with probability prob/65536, otherwise it returns the alias of
+ * the column. `mass` and `work` are scratch space for the build. */
+struct tsch_ql_alias {
+  uint16_t size;
+  uint16_t *prob;
+  uint16_t *alias;
+  uint32_t *mass;
+  uint16_t *work;
+  uint32_t total;   /* sum of the weights, 0 if the table is empty */
+};
+
+/* Declare an alias table over `num` entries */
+#define TSCH_QL_ALIAS(name, num) \
+  static uint16_t CC_CONCAT(name,_prob)[(num)]; \
+  static uint16_t CC_CONCAT(name,_alias)[(num)]; \
+  static uint32_t CC_CONCAT(name,_mass)[(num)]; \
+  static uint16_t CC_CONCAT(name,_work)[(num)]; \
+  static struct tsch_ql_alias name = { (num), CC_CONCAT(name,_prob), \
+                                       CC_CONCAT(name,_alias), CC_CONCAT(name,_mass), \
+                                       CC_CONCAT(name,_work), 0 }
+
+/********** Functions *********/
+
+/**
+ * \brief Rebuild the table from new weights, O(N)
+ * \param table The alias table
+ * \param weights One weight per entry, 0 means never drawn (at most 65535 each)
+ * \return The sum of the weights, the table cannot be drawn from if it is 0
+ */
+uint32_t tsch_ql_alias_build(struct tsch_ql_alias *table, const uint16_t *weights);
+/**
+ * \brief Draw an entry with a probability proportional to its weight, O(1)
+ * \param table The alias table, built with a non-zero total weight
+ * \return The entry
+ */
+uint16_t tsch_ql_alias_draw(const struct tsch_ql_alias *table);
+
+#endif /* __TSCH_QL_ALIAS_H__ */
+/** @} */
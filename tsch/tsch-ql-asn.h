@@ -0,0 +1,64 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	ASN modulo cursors: keep `ASN mod n` up to date incrementally while the
+ *	ASN moves forward, instead of a 40-bit modulo at every wake-up
+*/
+
+#ifndef __TSCH_QL_ASN_H__
+#define __TSCH_QL_ASN_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+
+/********** Data types **********/
+
+/* The last ASN a cursor was moved to, and that ASN modulo `divisor`.
+ * A zeroed cursor is valid, its first use resynchronizes it */
+struct tsch_ql_asn_cursor {
+  struct tsch_asn_t asn;
+  uint16_t divisor;   /* 0 until the first use */
+  uint16_t value;
+};
+
+/********** Functions *********/
+
+/**
+ * \brief Get ASN modulo a divisor. Moving forward costs an addition (a mask
+ * for power-of-two divisors), the full modulo is only done on the first use,
+ * on a new divisor and when the ASN jumps back (resynchronization, association)
+ * \param c The cursor
+ * \param asn The ASN
+ * \param div The divisor
+ * \return asn % div
+ */
+static inline uint16_t
+tsch_ql_asn_mod(struct tsch_ql_asn_cursor *c, const struct tsch_asn_t *asn,
+                const struct tsch_asn_divisor_t *div)
+{
+  uint32_t diff = asn->ls4b - c->asn.ls4b;
+  uint16_t ms1b = c->asn.ms1b + (asn->ls4b < c->asn.ls4b);
+  uint8_t pow2 = (div->val & (div->val - 1)) == 0;
+
+  /* Moving forward keeps the ms1b, or carries into it without wrapping the 40 bits */
+  if(c->divisor != div->val || ms1b != asn->ms1b) {
+    /* 2^32 is a multiple of a power of two, the ms1b does not matter then */
+    c->value = pow2 ? (asn->ls4b & (div->val - 1)) : TSCH_ASN_MOD(*asn, *div);
+    c->divisor = div->val;
+  } else if(pow2) {
+    c->value = (c->value + diff) & (div->val - 1);
+  } else if(diff < div->val) {
+    /* in 32 bits, the sum of two values below a divisor above 2^15 overflows 16 bits */
+    uint32_t value = (uint32_t)c->value + diff;
+    c->value = value >= div->val ? value - div->val : value;
+  } else {
+    c->value = (c->value + diff % div->val) % div->val;
+  }
+  c->asn = *asn;
+  return c->value;
+}
+
+#endif /* __TSCH_QL_ASN_H__ */
+/** @} */
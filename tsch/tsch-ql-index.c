@@ -0,0 +1,126 @@
+/**
+ * \file
+ *         Incrementally maintained argmax/argmin index (tournament tree).
+ *         The tree keeps the best entry of every subtree together with the
+ *         number of entries tied with it, so that a changed entry is re-ranked
+ *         in O(log N) and ties can be broken uniformly at random in O(log N).
+ */
+
+/**
+ * \addtogroup tsch
+ * @{
+*/
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch-ql-index.h"
+
+/*---------------------------------------------------------------------------*/
+/* Recompute an inner node from its two children */
+static void
+merge(struct tsch_ql_index *idx, uint16_t node)
+{
+  uint16_t left = 2 * node;
+  uint16_t right = left + 1;
+  int cmp;
+
+  /* Excluded subtrees lose against anything */
+  if(idx->ties[right] == 0) {
+    cmp = 1;
+  } else if(idx->ties[left] == 0) {
+    cmp = -1;
+  } else {
+    cmp = idx->compare(idx->winner[left], idx->winner[right]);
+  }
+
+  if(cmp > 0) {
+    idx->winner[node] = idx->winner[left];
+    idx->ties[node] = idx->ties[left];
+  } else if(cmp < 0) {
+    idx->winner[node] = idx->winner[right];
+    idx->ties[node] = idx->ties[right];
+  } else {
+    idx->winner[node] = idx->winner[left];
+    idx->ties[node] = idx->ties[left] + idx->ties[right];
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_index_init(struct tsch_ql_index *idx)
+{
+  uint16_t node;
+
+  for(node = 0; node < idx->size; node++) {
+    idx->winner[idx->size + node] = node;
+    idx->ties[idx->size + node] = 1;
+  }
+  for(node = idx->size - 1; node > 0; node--) {
+    merge(idx, node);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_index_update(struct tsch_ql_index *idx, uint16_t entry)
+{
+  uint16_t node = (idx->size + entry) / 2;
+
+  while(node > 0) {
+    merge(idx, node);
+    node /= 2;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_index_exclude(struct tsch_ql_index *idx, uint16_t entry)
+{
+  idx->ties[idx->size + entry] = 0;
+  tsch_ql_index_update(idx, entry);
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_index_include(struct tsch_ql_index *idx, uint16_t entry)
+{
+  idx->ties[idx->size + entry] = 1;
+  tsch_ql_index_update(idx, entry);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tsch_ql_index_peek(const struct tsch_ql_index *idx)
+{
+  return idx->size == 1 ? 0 : idx->winner[1];
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tsch_ql_index_best(const struct tsch_ql_index *idx)
+{
+  uint16_t best;
+  uint16_t node;
+  uint16_t pick;
+
+  if(idx->size == 1) {
+    return 0;
+  }
+
+  best = idx->winner[1];
+  if(idx->ties[1] <= 1) {
+    return best;
+  }
+
+  /* Walk down towards the pick-th of the tied entries */
+  pick = random_rand() % idx->ties[1];
+  node = 1;
+  while(node < idx->size) {
+    uint16_t left = 2 * node;
+    if(idx->ties[left] > 0 && idx->compare(idx->winner[left], best) == 0) {
+      if(pick < idx->ties[left]) {
+        node = left;
+        continue;
+      }
+      pick -= idx->ties[left];
+    }
+    node = left + 1;
+  }
+  return idx->winner[node];
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,81 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	Incrementally maintained argmax/argmin index (tournament tree) used by
+ *	QL-TSCH for the Q-table and the APT table. On the host the tree breaks even
+ *	with a linear scan at about 100 entries; at the 15 timeslots of the default
+ *	slotframe it is slower than the scan (see make -C tests bench)
+*/
+
+#ifndef __TSCH_QL_INDEX_H__
+#define __TSCH_QL_INDEX_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+
+/********** Data types **********/
+
+/* Returns >0 if entry a is better than entry b, <0 if worse and 0 if tied */
+typedef int (* tsch_ql_index_compare_t)(uint16_t a, uint16_t b);
+
+/* A tournament tree over `size` entries. Node 1 is the root, the children of
+ * node i are 2i and 2i+1, and entry e is stored as leaf node size+e. Every
+ * node holds the best entry of its subtree and how many entries are tied with it.
+ * An excluded entry is a leaf with no ties, it never wins against a ranked entry. */
+struct tsch_ql_index {
+  uint16_t size;
+  uint16_t *winner;
+  uint16_t *ties;
+  tsch_ql_index_compare_t compare;
+};
+
+/* Declare an index over `num` entries, ranked by the `compare` function */
+#define TSCH_QL_INDEX(name, num, compare) \
+  static uint16_t CC_CONCAT(name,_winner)[2 * (num)]; \
+  static uint16_t CC_CONCAT(name,_ties)[2 * (num)]; \
+  static struct tsch_ql_index name = { (num), CC_CONCAT(name,_winner), \
+                                       CC_CONCAT(name,_ties), (compare) }
+
+/********** Functions *********/
+
+/**
+ * \brief Rebuild the whole index from the current values, O(N)
+ * \param idx The index
+ */
+void tsch_ql_index_init(struct tsch_ql_index *idx);
+/**
+ * \brief Re-rank a single entry after its value changed, O(log N)
+ * \param idx The index
+ * \param entry The entry that changed
+ */
+void tsch_ql_index_update(struct tsch_ql_index *idx, uint16_t entry);
+/**
+ * \brief Take an entry out of the ranking (e.g. to get the next best entries), O(log N)
+ * \param idx The index
+ * \param entry The entry to exclude
+ */
+void tsch_ql_index_exclude(struct tsch_ql_index *idx, uint16_t entry);
+/**
+ * \brief Put an excluded entry back into the ranking, O(log N)
+ * \param idx The index
+ * \param entry The entry to include
+ */
+void tsch_ql_index_include(struct tsch_ql_index *idx, uint16_t entry);
+/**
+ * \brief Get one of the best entries without drawing among ties, O(1).
+ * Enough when only the best value is needed.
+ * \param idx The index
+ * \return A best entry
+ */
+uint16_t tsch_ql_index_peek(const struct tsch_ql_index *idx);
+/**
+ * \brief Get the best entry, ties are broken uniformly at random, O(log N)
+ * \param idx The index
+ * \return The best entry
+ */
+uint16_t tsch_ql_index_best(const struct tsch_ql_index *idx);
+
+#endif /* __TSCH_QL_INDEX_H__ */
+/** @} */
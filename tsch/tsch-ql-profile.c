@@ -0,0 +1,100 @@
+/**
+ * \file
+ *         Latency profiler of the slot operation. Phases are timestamped with
+ *         RTIMER_NOW() from the slot interrupt and their durations counted in
+ *         logarithmic buckets, so that the slack left before the deadlines
+ *         can be read from a running node.
+ */
+
+/**
+ * \addtogroup tsch
+ * @{
+*/
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "sys/critical.h"
+#include <string.h>
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "TSCH Prof"
+#define LOG_LEVEL LOG_LEVEL_MAC
+
+#if QL_TSCH_ENABLED && QL_SLOT_PROFILE
+
+static rtimer_clock_t phase_start[TSCH_QL_PHASE_NUM];
+static struct tsch_ql_profile_histogram histograms[TSCH_QL_PHASE_NUM];
+
+static const char *phase_names[TSCH_QL_PHASE_NUM] = {
+  "slot", "link-lookup", "packet-fetch", "radio-prepare", "tx", "ack-wait", "rx-processing", "ql-hooks",
+};
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_profile_begin(enum tsch_ql_profile_phase phase)
+{
+  phase_start[phase] = RTIMER_NOW();
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_profile_end(enum tsch_ql_profile_phase phase)
+{
+  rtimer_clock_t duration = RTIMER_NOW() - phase_start[phase];
+  struct tsch_ql_profile_histogram *h = &histograms[phase];
+  rtimer_clock_t limit = QL_SLOT_PROFILE_BUCKET_TICKS;
+  uint8_t bucket = 0;
+
+  while(bucket < QL_SLOT_PROFILE_BUCKETS - 1 && duration >= limit) {
+    bucket++;
+    limit <<= 1;
+  }
+  if(h->buckets[bucket] < 0xffff) {
+    h->buckets[bucket]++;
+  }
+  h->count++;
+  if(duration > h->max) {
+    h->max = duration;
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct tsch_ql_profile_histogram *
+tsch_ql_profile_get(enum tsch_ql_profile_phase phase)
+{
+  return &histograms[phase];
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_ql_profile_phase_name(enum tsch_ql_profile_phase phase)
+{
+  return phase < TSCH_QL_PHASE_NUM ? phase_names[phase] : "?";
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_profile_reset(void)
+{
+  /* The slot interrupt writes the histograms */
+  int_master_status_t status = critical_enter();
+  memset(histograms, 0, sizeof(histograms));
+  critical_exit(status);
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_ql_profile_log(void)
+{
+  uint8_t phase;
+  uint8_t bucket;
+
+  LOG_INFO("slot profile, buckets from %u ticks doubling (%lu ticks/s)\n",
+           (unsigned)QL_SLOT_PROFILE_BUCKET_TICKS, (unsigned long)RTIMER_SECOND);
+  for(phase = 0; phase < TSCH_QL_PHASE_NUM; phase++) {
+    const struct tsch_ql_profile_histogram *h = &histograms[phase];
+    LOG_INFO("%s: n %lu max %lu |", phase_names[phase], (unsigned long)h->count, (unsigned long)h->max);
+    for(bucket = 0; bucket < QL_SLOT_PROFILE_BUCKETS; bucket++) {
+      LOG_INFO_(" %u", h->buckets[bucket]);
+    }
+    LOG_INFO_("\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* QL_TSCH_ENABLED && QL_SLOT_PROFILE */
+/** @} */
@@ -0,0 +1,83 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	Latency profiler of the slot operation: rtimer timestamps around the
+ *	phases of a slot, accumulated into per-phase histograms
+*/
+
+#ifndef __TSCH_QL_PROFILE_H__
+#define __TSCH_QL_PROFILE_H__
+
+/********** Includes **********/
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+/********** Data types **********/
+
+/* Profiled phases of the slot operation */
+enum tsch_ql_profile_phase {
+  TSCH_QL_PHASE_SLOT,           /* whole slot, from the start of the slot operation to its end */
+  TSCH_QL_PHASE_LINK_LOOKUP,    /* next active link */
+  TSCH_QL_PHASE_PACKET_FETCH,   /* packet and neighbor for the link */
+  TSCH_QL_PHASE_RADIO_PREPARE,  /* copy to the radio buffer */
+  TSCH_QL_PHASE_TX,             /* transmit call */
+  TSCH_QL_PHASE_ACK_WAIT,       /* from the end of the Tx to the ACK being read */
+  TSCH_QL_PHASE_RX_PROCESSING,  /* reading and handling a received frame */
+  TSCH_QL_PHASE_QL_HOOKS,       /* QL-TSCH bookkeeping (outcomes, APT, commands, boundary) */
+  TSCH_QL_PHASE_NUM
+};
+
+/* Histogram of a phase. Bucket 0 counts durations below
+ * QL_SLOT_PROFILE_BUCKET_TICKS, bucket i below that times 2^i, and the
+ * last bucket everything longer */
+struct tsch_ql_profile_histogram {
+  uint16_t buckets[QL_SLOT_PROFILE_BUCKETS];   /* saturating */
+  uint32_t count;
+  rtimer_clock_t max;
+};
+
+/********** Macros **********/
+
+#if QL_SLOT_PROFILE
+#define TSCH_QL_PROFILE_BEGIN(phase) tsch_ql_profile_begin(phase)
+#define TSCH_QL_PROFILE_END(phase) tsch_ql_profile_end(phase)
+#else /* QL_SLOT_PROFILE */
+#define TSCH_QL_PROFILE_BEGIN(phase)
+#define TSCH_QL_PROFILE_END(phase)
+#endif /* QL_SLOT_PROFILE */
+
+/********** Functions *********/
+
+/**
+ * \brief Timestamp the start of a phase (the timestamp survives protothread yields)
+ * \param phase The phase
+ */
+void tsch_ql_profile_begin(enum tsch_ql_profile_phase phase);
+/**
+ * \brief Add the time since the start of a phase to its histogram
+ * \param phase The phase
+ */
+void tsch_ql_profile_end(enum tsch_ql_profile_phase phase);
+/**
+ * \brief Get the histogram of a phase
+ * \param phase The phase
+ * \return The histogram
+ */
+const struct tsch_ql_profile_histogram *tsch_ql_profile_get(enum tsch_ql_profile_phase phase);
+/**
+ * \brief Name of a phase, for printing
+ */
+const char *tsch_ql_profile_phase_name(enum tsch_ql_profile_phase phase);
+/**
+ * \brief Clear all histograms
+ */
+void tsch_ql_profile_reset(void);
+/**
+ * \brief Log all histograms, one line per phase
+ */
+void tsch_ql_profile_log(void);
+
+#endif /* __TSCH_QL_PROFILE_H__ */
+/** @} */
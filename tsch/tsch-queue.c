@@ -249,6 +249,12 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
       if(put_index != -1) {
         p = memb_alloc(&packet_memb);
         if(p != NULL) {
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+          /* Remember when the packet was queued (low bits of the ASN), for the queueing delay */
+          packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, (uint16_t)tsch_current_asn.ls4b);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
           /* Enqueue packet */
           p->qb = queuebuf_new_from_packetbuf();
           if(p->qb != NULL) {
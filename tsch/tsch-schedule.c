@@ -54,6 +54,7 @@
 #include "net/mac/framer/frame802154.h"
 #include "sys/process.h"
 #include "sys/rtimer.h"
+#include "sys/critical.h"
 #include <string.h>
 
 /* Log configuration */
@@ -68,6 +69,77 @@ MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
 
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+/* Schedule changes queued by process context, applied by the slot operation
+ * between two slots (single producer, single consumer) */
+enum tsch_ql_schedule_cmd_type {
+  TSCH_QL_CMD_NONE,       /* cancelled */
+  TSCH_QL_CMD_ADD,
+  TSCH_QL_CMD_UPDATE,
+};
+struct tsch_ql_schedule_cmd {
+  uint8_t type;
+  uint8_t link_options;
+  uint8_t link_type;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  struct tsch_slotframe *slotframe;
+  struct tsch_link *link;
+  struct tsch_link **result;  /* add: where the new link is stored once applied */
+  linkaddr_t addr;
+};
+/* Current timeslot of every slotframe, kept up to date as the ASN moves forward
+ * (indexed by the position of the slotframe in slotframe_memb) */
+static struct tsch_ql_asn_cursor slotframe_cursors[TSCH_SCHEDULE_MAX_SLOTFRAMES];
+#define SLOTFRAME_CURSOR(sf) (&slotframe_cursors[(sf) - (struct tsch_slotframe *)slotframe_memb.mem])
+
+static struct ringbufindex schedule_cmd_ringbuf;
+static struct tsch_ql_schedule_cmd schedule_cmd_array[QL_SCHEDULE_CMD_RING_SIZE];
+
+/* Drop the queued commands of a slotframe or of a link that is going away.
+ * Called with the lock held, so the slot operation does not consume meanwhile */
+static void
+schedule_cmd_cancel(const struct tsch_slotframe *slotframe, const struct tsch_link *l)
+{
+  uint8_t i;
+  for(i = schedule_cmd_ringbuf.get_ptr; i != schedule_cmd_ringbuf.put_ptr;
+      i = (i + 1) & schedule_cmd_ringbuf.mask) {
+    struct tsch_ql_schedule_cmd *cmd = &schedule_cmd_array[i];
+    if((slotframe != NULL && cmd->slotframe == slotframe) || (l != NULL && cmd->link == l)) {
+      cmd->type = TSCH_QL_CMD_NONE;
+    }
+  }
+}
+
+#if QL_SCHEDULE_CALENDAR
+/* Calendar of the hyperperiod (LCM of the slotframe lengths): for every
+ * position the best and backup link of that timeslot, and how many slots
+ * ahead the next active position is */
+struct tsch_ql_calendar_entry {
+  struct tsch_link *best;
+  struct tsch_link *backup;
+  uint16_t next;
+  uint8_t dynamic;        /* the best link depends on the queues, ask the link comparator */
+};
+struct tsch_ql_calendar {
+  struct tsch_ql_calendar_entry entries[QL_SCHEDULE_CALENDAR_MAX_LEN];
+  struct tsch_asn_divisor_t div;
+  uint16_t len;           /* 0 if there is no schedule or it does not fit */
+};
+/* Built in process context by tsch_ql_calendar_process. The slot operation
+ * only reads it through `calendar`, which is NULL (walk the links) from the
+ * moment the schedule changes until the rebuilt calendar is published */
+static struct tsch_ql_calendar calendar_buf;
+static struct tsch_ql_calendar *volatile calendar;
+/* Counts the invalidations, a build that saw one meanwhile is not published */
+static volatile uint16_t calendar_generation;
+static struct tsch_ql_asn_cursor calendar_cursor;
+PROCESS(tsch_ql_calendar_process, "QL-TSCH schedule calendar");
+#endif /* QL_SCHEDULE_CALENDAR */
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
+
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
 tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
@@ -125,6 +197,11 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
 
     /* Now that the slotframe has no links, remove it. */
     if(tsch_get_lock()) {
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      schedule_cmd_cancel(slotframe, NULL);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
       LOG_INFO("remove slotframe %u %u\n", slotframe->handle, slotframe->size.val);
       memb_free(&slotframe_memb, slotframe);
       list_remove(slotframe_list, slotframe);
@@ -310,6 +387,11 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
 
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      schedule_cmd_cancel(NULL, l);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
 
       /* Release the lock before we update the neighbor (will take the lock) */
       tsch_release_lock();
@@ -332,6 +414,243 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
   }
   return 0;
 }
+/**************************** My modifications - Start ********************************/
+/* Changes link options, timeslot and channel offset of a link in place.
+ * Unlike a remove/add pair this takes the lock once and neither frees nor
+ * allocates the link. Return 1 if success, 0 if failure */
+int
+tsch_schedule_update_link(struct tsch_slotframe *slotframe, struct tsch_link *l,
+                          uint8_t link_options, uint16_t timeslot, uint16_t channel_offset)
+{
+  struct tsch_link_update u;
+
+  u.link = l;
+  u.link_options = link_options;
+  u.timeslot = timeslot;
+  u.channel_offset = channel_offset;
+  return tsch_schedule_update_links(slotframe, &u, 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Changes several links of a slotframe in place under a single lock, e.g.
+ * a Tx cell and an Rx cell swapping places. Nothing is changed unless all
+ * the updates are valid. Return 1 if success, 0 if failure */
+int
+tsch_schedule_update_links(struct tsch_slotframe *slotframe, struct tsch_link_update *updates, uint8_t num)
+{
+  uint8_t i;
+
+  if(slotframe == NULL) {
+    return 0;
+  }
+  for(i = 0; i < num; i++) {
+    struct tsch_link_update *u = &updates[i];
+    if(u->link == NULL || u->link->slotframe_handle != slotframe->handle) {
+      return 0;
+    }
+    if(u->timeslot > (slotframe->size.val - 1)) {
+      LOG_ERR("! update_link invalid timeslot: %u\n", u->timeslot);
+      return 0;
+    }
+    /* The neighbor can only be looked up (or added) while TSCH is not locked */
+    u->nbr = tsch_queue_get_nbr(&u->link->addr);
+    if(u->nbr == NULL && (u->link_options & LINK_OPTION_TX)) {
+      u->nbr = tsch_queue_add_nbr(&u->link->addr);
+    }
+  }
+
+  if(!tsch_get_lock()) {
+    LOG_ERR("! update_link couldn't take lock\n");
+    return 0;
+  }
+
+  for(i = 0; i < num; i++) {
+    struct tsch_link_update *u = &updates[i];
+    struct tsch_link *l = u->link;
+    struct tsch_neighbor *n = u->nbr;
+    uint8_t old_options = l->link_options;
+
+    /* The link is scheduled as next for its old timeslot, abort that operation */
+    if(l == current_link && l->timeslot != u->timeslot) {
+      current_link = NULL;
+    }
+    l->link_options = u->link_options;
+    l->timeslot = u->timeslot;
+    l->channel_offset = u->channel_offset;
+
+    /* Keep the tx link counters of the neighbor in sync with the new options */
+    if(n != NULL) {
+      if(old_options & LINK_OPTION_TX) {
+        n->tx_links_count--;
+        if(!(old_options & LINK_OPTION_SHARED)) {
+          n->dedicated_tx_links_count--;
+        }
+      }
+      if(u->link_options & LINK_OPTION_TX) {
+        n->tx_links_count++;
+        if(!(u->link_options & LINK_OPTION_SHARED)) {
+          n->dedicated_tx_links_count++;
+        }
+      }
+    }
+  }
+
+  tsch_release_lock();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if QL_TSCH_ENABLED
+/* Neighbor counters of the Tx links, like add_link and remove_link do them */
+static void
+schedule_cmd_count_tx_link(struct tsch_neighbor *n, uint8_t link_options, int delta)
+{
+  if(n != NULL && (link_options & LINK_OPTION_TX)) {
+    n->tx_links_count += delta;
+    if(!(link_options & LINK_OPTION_SHARED)) {
+      n->dedicated_tx_links_count += delta;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Reserve the next command of the ring, NULL if it is full */
+static struct tsch_ql_schedule_cmd *
+schedule_cmd_put(uint8_t type, struct tsch_slotframe *slotframe, struct tsch_link *l,
+                 uint8_t link_options, uint16_t timeslot, uint16_t channel_offset)
+{
+  struct tsch_ql_schedule_cmd *cmd;
+  int put_index;
+
+  if(slotframe == NULL || timeslot > (slotframe->size.val - 1)) {
+    return NULL;
+  }
+  put_index = ringbufindex_peek_put(&schedule_cmd_ringbuf);
+  if(put_index == -1) {
+    LOG_WARN("! schedule command ring full\n");
+    return NULL;
+  }
+  cmd = &schedule_cmd_array[put_index];
+  cmd->type = type;
+  cmd->slotframe = slotframe;
+  cmd->link = l;
+  cmd->result = NULL;
+  cmd->link_options = link_options;
+  cmd->timeslot = timeslot;
+  cmd->channel_offset = channel_offset;
+  return cmd;
+}
+/*---------------------------------------------------------------------------*/
+/* The slot operation only looks up neighbors, so a Tx neighbor is added here */
+static void
+schedule_cmd_prepare_nbr(const linkaddr_t *addr, uint8_t link_options)
+{
+  if((link_options & LINK_OPTION_TX) && tsch_queue_get_nbr(addr) == NULL) {
+    tsch_queue_add_nbr(addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_enqueue_add_link(struct tsch_slotframe *slotframe, uint8_t link_options,
+                               enum link_type link_type, const linkaddr_t *address,
+                               uint16_t timeslot, uint16_t channel_offset,
+                               struct tsch_link **result)
+{
+  struct tsch_ql_schedule_cmd *cmd;
+
+  if(address == NULL) {
+    address = &linkaddr_null;
+  }
+  schedule_cmd_prepare_nbr(address, link_options);
+  cmd = schedule_cmd_put(TSCH_QL_CMD_ADD, slotframe, NULL, link_options, timeslot, channel_offset);
+  if(cmd == NULL) {
+    return 0;
+  }
+  cmd->link_type = link_type;
+  cmd->result = result;
+  linkaddr_copy(&cmd->addr, address);
+  ringbufindex_put(&schedule_cmd_ringbuf);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_enqueue_update_link(struct tsch_slotframe *slotframe, struct tsch_link *l,
+                                  uint8_t link_options, uint16_t timeslot, uint16_t channel_offset)
+{
+  if(l == NULL || slotframe == NULL || l->slotframe_handle != slotframe->handle) {
+    return 0;
+  }
+  schedule_cmd_prepare_nbr(&l->addr, link_options);
+  if(schedule_cmd_put(TSCH_QL_CMD_UPDATE, slotframe, l, link_options, timeslot, channel_offset) == NULL) {
+    return 0;
+  }
+  ringbufindex_put(&schedule_cmd_ringbuf);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_schedule_enqueue_space(void)
+{
+  /* one entry of the ring stays empty to tell a full ring from an empty one */
+  return ringbufindex_size(&schedule_cmd_ringbuf) - 1 - ringbufindex_elements(&schedule_cmd_ringbuf);
+}
+/*---------------------------------------------------------------------------*/
+/* Called by the slot operation between two slots, before the next link is
+ * looked up. Nothing is applied while process context holds (or waits for)
+ * the lock, as it may be walking or changing the same lists */
+void
+tsch_schedule_apply_commands(void)
+{
+  int get_index;
+
+  if(tsch_is_locked()) {
+    return;
+  }
+  while((get_index = ringbufindex_peek_get(&schedule_cmd_ringbuf)) != -1) {
+    struct tsch_ql_schedule_cmd *cmd = &schedule_cmd_array[get_index];
+    struct tsch_link *l = cmd->link;
+
+    switch(cmd->type) {
+    case TSCH_QL_CMD_ADD:
+      /* Added again before the first add was applied: change that link instead */
+      if(cmd->result != NULL && *cmd->result != NULL) {
+        l = *cmd->result;
+      } else {
+        l = memb_alloc(&link_memb);
+        if(l != NULL) {
+          static int current_link_handle = 0x8000;  /* apart from the handles of add_link */
+          list_add(cmd->slotframe->links_list, l);
+          l->handle = current_link_handle++;
+          l->link_options = cmd->link_options;
+          l->link_type = cmd->link_type;
+          l->slotframe_handle = cmd->slotframe->handle;
+          l->timeslot = cmd->timeslot;
+          l->channel_offset = cmd->channel_offset;
+          l->data = NULL;
+          linkaddr_copy(&l->addr, &cmd->addr);
+          schedule_cmd_count_tx_link(tsch_queue_get_nbr(&l->addr), l->link_options, 1);
+          if(cmd->result != NULL) {
+            *cmd->result = l;
+          }
+        }
+        break;
+      }
+      /* fall through */
+    case TSCH_QL_CMD_UPDATE:
+      schedule_cmd_count_tx_link(tsch_queue_get_nbr(&l->addr), l->link_options, -1);
+      l->link_options = cmd->link_options;
+      l->timeslot = cmd->timeslot;
+      l->channel_offset = cmd->channel_offset;
+      schedule_cmd_count_tx_link(tsch_queue_get_nbr(&l->addr), l->link_options, 1);
+      break;
+    default:
+      break;
+    }
+    ringbufindex_get(&schedule_cmd_ringbuf);
+#if QL_SCHEDULE_CALENDAR
+    tsch_schedule_calendar_invalidate();
+#endif /* QL_SCHEDULE_CALENDAR */
+  }
+}
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
 /*---------------------------------------------------------------------------*/
 /* Removes a link from slotframe and timeslot. Return a 1 if success, 0 if failure */
 int
@@ -400,6 +719,183 @@ default_tsch_link_comparator(struct tsch_link *a, struct tsch_link *b)
   return a;
 }
 
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR
+/*---------------------------------------------------------------------------*/
+/* Add a link to the position of its timeslot, with the same overlap rules
+ * as tsch_schedule_get_next_active_link */
+static void
+calendar_add(struct tsch_ql_calendar_entry *e, struct tsch_link *l)
+{
+  struct tsch_link *new_best = NULL;
+
+  if(e->best == NULL) {
+    e->best = l;
+    return;
+  }
+  if((e->best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+    if(l->slotframe_handle != e->best->slotframe_handle) {
+      if(l->slotframe_handle < e->best->slotframe_handle) {
+        new_best = l;
+      }
+    } else {
+#ifdef TSCH_CONF_LINK_COMPARATOR
+      /* A custom comparator may look at anything */
+      e->dynamic = 1;
+#else
+      /* The default comparator only looks at the queues of two different Tx neighbors */
+      if((l->link_options & LINK_OPTION_TX) && !linkaddr_cmp(&l->addr, &e->best->addr)) {
+        e->dynamic = 1;
+      }
+#endif
+      new_best = TSCH_LINK_COMPARATOR(e->best, l);
+    }
+  } else if(l->link_options & LINK_OPTION_TX) {
+    new_best = l;
+  }
+
+  if(new_best != l && (l->link_options & LINK_OPTION_RX)) {
+    if(e->backup == NULL || l->slotframe_handle < e->backup->slotframe_handle) {
+      e->backup = l;
+    }
+  }
+  if(new_best != e->best && (e->best->link_options & LINK_OPTION_RX)) {
+    if(e->backup == NULL || e->best->slotframe_handle < e->backup->slotframe_handle) {
+      e->backup = e->best;
+    }
+  }
+  if(new_best != NULL) {
+    e->best = new_best;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Compile the schedule into a calendar, O(links * hyperperiod / slotframe length) */
+static void
+calendar_build(struct tsch_ql_calendar *c)
+{
+  struct tsch_slotframe *sf;
+  uint32_t len = 1;
+  int32_t nearest = -1;
+  uint16_t p;
+
+  c->len = 0;
+  if(list_head(slotframe_list) == NULL) {
+    return;
+  }
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    uint32_t a = len, b = sf->size.val;
+    while(b != 0) {
+      uint32_t t = a % b;
+      a = b;
+      b = t;
+    }
+    len = len / a * sf->size.val;
+    if(len > QL_SCHEDULE_CALENDAR_MAX_LEN) {
+      /* Too long a hyperperiod, walk the links instead */
+      return;
+    }
+  }
+
+  memset(c->entries, 0, len * sizeof(c->entries[0]));
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    struct tsch_link *l;
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      if(!(l->link_options & (LINK_OPTION_TX | LINK_OPTION_RX))) {
+        /* A sleeping link (e.g. a pruned Rx cell) would only wake the node up for nothing */
+        continue;
+      }
+      for(p = l->timeslot; p < len; p += sf->size.val) {
+        calendar_add(&c->entries[p], l);
+      }
+    }
+  }
+
+  /* Distance to the next active position, wrapping around */
+  for(p = 0; p < len && nearest < 0; p++) {
+    if(c->entries[p].best != NULL) {
+      nearest = p + len;
+    }
+  }
+  if(nearest < 0) {
+    /* No links at all */
+    return;
+  }
+  for(p = len; p-- > 0;) {
+    c->entries[p].next = nearest - p;
+    if(c->entries[p].best != NULL) {
+      nearest = p;
+    }
+  }
+  TSCH_ASN_DIVISOR_INIT(c->div, len);
+  c->len = len;
+}
+/*---------------------------------------------------------------------------*/
+/* Rebuilds the calendar after the schedule changed, out of the rtimer interrupt.
+ * The lists are only changed by process context (with the lock, which this
+ * process does not run into) and by the queued commands, which invalidate
+ * the calendar again: a build that overlapped one is thrown away */
+PROCESS_THREAD(tsch_ql_calendar_process, ev, data)
+{
+  static uint16_t generation;
+  int_master_status_t status;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    generation = calendar_generation;
+    if(calendar != NULL) {
+      continue;
+    }
+    calendar_build(&calendar_buf);
+    status = critical_enter();
+    if(generation == calendar_generation) {
+      calendar = &calendar_buf;
+    }
+    critical_exit(status);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/* O(1) version of tsch_schedule_get_next_active_link, returns 0 if the links
+ * have to be walked instead */
+static int
+calendar_lookup(struct tsch_asn_t *asn, uint16_t *time_offset,
+                struct tsch_link **backup_link, struct tsch_link **best)
+{
+  uint16_t p;
+  struct tsch_ql_calendar_entry *e;
+  struct tsch_ql_calendar *c = calendar;
+
+  if(c == NULL || c->len == 0) {
+    return 0;
+  }
+  p = tsch_ql_asn_mod(&calendar_cursor, asn, &c->div);
+  e = &c->entries[(p + c->entries[p].next) % c->len];
+  if(e->dynamic) {
+    return 0;
+  }
+  if(time_offset != NULL) {
+    *time_offset = c->entries[p].next;
+  }
+  if(backup_link != NULL) {
+    *backup_link = e->backup;
+  }
+  *best = e->best;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_schedule_calendar_invalidate(void)
+{
+  calendar = NULL;
+  calendar_generation++;
+  process_poll(&tsch_ql_calendar_process);
+}
+#endif /* QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR */
+/**************************** My modifications - End **********************************/
 /*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
@@ -414,10 +910,23 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
   must have Rx flag set. */
   if(!tsch_is_locked()) {
     struct tsch_slotframe *sf = list_head(slotframe_list);
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR
+    if(calendar_lookup(asn, time_offset, backup_link, &curr_best)) {
+      return curr_best;
+    }
+#endif /* QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR */
+/**************************** My modifications - End **********************************/
     /* For each slotframe, look for the earliest occurring link */
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      uint16_t timeslot = tsch_ql_asn_mod(SLOTFRAME_CURSOR(sf), asn, &sf->size);
+#else
       uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
       struct tsch_link *l = list_head(sf->links_list);
       while(l != NULL) {
         uint16_t time_to_timeslot =
@@ -491,6 +1000,14 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+    ringbufindex_init(&schedule_cmd_ringbuf, QL_SCHEDULE_CMD_RING_SIZE);
+#if QL_SCHEDULE_CALENDAR
+    process_start(&tsch_ql_calendar_process, NULL);
+#endif /* QL_SCHEDULE_CALENDAR */
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
     tsch_release_lock();
     return 1;
   } else {
@@ -53,10 +53,12 @@
 #include "net/mac/framer/framer-802154.h"
 #include "net/mac/tsch/tsch.h"
 #include "sys/critical.h"
+#include "sys/energest.h"
 
 /**************************** My modifications - Start ********************************/
 #include "customized-tsch-file.h"
 #include "lib/random.h"
+#include <string.h>
 /**************************** My modifications - End **********************************/
 
 #include "sys/log.h"
@@ -188,45 +190,499 @@ static PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t));
 /* QL-TSCH algorithm */
 #if QL_TSCH_ENABLED
 
-// record Tx slot status 
-uint8_t trans_status = 0;
+// ring of Tx outcomes, filled by the Tx slot and emptied by the scheduler
+static struct ringbufindex tx_outcome_ringbuf;
+static struct tsch_ql_tx_outcome tx_outcome_array[QL_TX_OUTCOME_RING_SIZE];
 
-// array to store APT table
-uint8_t apt_table[UNICAST_SLOTFRAME_LENGTH];
+// Tx counters since the last summary
+static uint16_t ql_tx_ok;
+static uint16_t ql_tx_failed;
+static uint16_t ql_tx_dropped;
+
+// RSSI and LQI of the last accepted ACK
+static int8_t ql_ack_rssi;
+static uint8_t ql_ack_lqi;
+
+// APT occupancy, one exponentially weighted estimate per (timeslot, channel offset) cell (see QL_APT_ONE)
+static uint16_t apt_occupancy[QL_NUM_ACTIONS];
+
+// 8-bit view of the occupancy for the callers of get_apt_table()
+static uint8_t apt_table[QL_NUM_ACTIONS];
+
+// Rx cells of the unicast slotframe that heard energy but no frame, or a frame that did not decode
+static struct tsch_ql_rx_noise apt_rx_noise[UNICAST_SLOTFRAME_LENGTH];
+
+// frames received in the Rx timeslots of the unicast slotframe
+static uint16_t apt_rx_frames[UNICAST_SLOTFRAME_LENGTH];
+
+// only the cells of the unicast slotframe are in the APT table (a burst continues in the next timeslots,
+// not in the cell of the link)
+#define QL_APT_CELL(link) ((link)->slotframe_handle == 1 && (link)->channel_offset < QL_NUM_CHANNEL_OFFSETS && \
+                           tsch_current_burst_count == 0)
+
+// bursts of the QL slotframe stop after QL_BURST_MAX_LEN frames, the other slotframes are left to TSCH
+#define QL_BURST_ALLOWED(link) ((link)->slotframe_handle != 1 || tsch_current_burst_count + 1 < QL_BURST_MAX_LEN)
+
+// occupancy of a timeslot over all channel offsets
+static uint32_t apt_timeslot_load(uint16_t timeslot)
+{
+  uint32_t load = 0;
+  for (uint16_t ch = 0; ch < QL_NUM_CHANNEL_OFFSETS; ch++){
+    load += apt_occupancy[QL_ACTION(timeslot, ch)];
+  }
+  return load;
+}
+
+// same, for process context: the Rx slot may add to the cells of the timeslot while they are summed up
+static uint32_t apt_timeslot_load_copy(uint16_t timeslot)
+{
+  uint32_t load;
+  int_master_status_t status = critical_enter();
+  load = apt_timeslot_load(timeslot);
+  critical_exit(status);
+  return load;
+}
+
+// less occupied timeslots rank higher in the APT index
+static int apt_table_compare(uint16_t a, uint16_t b)
+{
+  uint32_t load_a = apt_timeslot_load(a);
+  uint32_t load_b = apt_timeslot_load(b);
+  return (load_a < load_b) - (load_a > load_b);
+}
+
+// argmin index over the APT table, updated on every reception
+TSCH_QL_INDEX(apt_index, UNICAST_SLOTFRAME_LENGTH, apt_table_compare);
+
+// sampler over the timeslots weighted by inverse occupancy, rebuilt on the first draw after a change
+TSCH_QL_ALIAS(apt_alias, UNICAST_SLOTFRAME_LENGTH);
+static uint16_t apt_alias_weights[UNICAST_SLOTFRAME_LENGTH];
+static uint8_t apt_alias_excluded[(UNICAST_SLOTFRAME_LENGTH + 7) / 8];
+static volatile uint8_t apt_changed = 1;
 
 // reset the values of APT table when requested
 void reset_apt_table()
 {
-  for (uint8_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++)
+  for (uint16_t i = 0; i < QL_NUM_ACTIONS; i++)
   {
-    apt_table[i] = 0;
+    apt_occupancy[i] = 0;
+  }
+  tsch_ql_index_init(&apt_index);
+  apt_changed = 1;
+}
+
+// count a reception (weight QL_APT_ONE) or a partial sign of use in a cell, saturating
+static void apt_table_add(uint16_t timeslot, uint16_t channel_offset, uint16_t weight)
+{
+  uint16_t *occupancy = &apt_occupancy[QL_ACTION(timeslot, channel_offset)];
+  uint16_t step = weight >> QL_APT_DECAY_SHIFT;
+  *occupancy = *occupancy > 0xffff - step ? 0xffff : *occupancy + step;
+  tsch_ql_index_update(&apt_index, timeslot);
+  apt_changed = 1;
+}
+
+// idle Rx cell: sample the channel while the radio is still on, energy means an undecodable Tx
+static void apt_table_sample_energy(const struct tsch_link *link)
+{
+  radio_value_t rssi;
+  if (NETSTACK_RADIO.get_value(RADIO_PARAM_RSSI, &rssi) == RADIO_RESULT_OK &&
+      rssi > QL_APT_ENERGY_THRESHOLD){
+    if (apt_rx_noise[link->timeslot].energy < 0xffff) apt_rx_noise[link->timeslot].energy++;
+    apt_table_add(link->timeslot, link->channel_offset, QL_APT_ENERGY_WEIGHT);
   }
 }
 
-// return the apt-table
+// a frame was on air but was dropped by the radio (CRC) or could not be parsed
+static void apt_table_add_crc_failure(const struct tsch_link *link)
+{
+  if (apt_rx_noise[link->timeslot].crc_failures < 0xffff) apt_rx_noise[link->timeslot].crc_failures++;
+  apt_table_add(link->timeslot, link->channel_offset, QL_APT_CRC_WEIGHT);
+}
+
+// age the occupancy once per decay period (rounded up so that idle cells reach 0). Runs in process
+// context, one timeslot at a time in a critical section as the Rx slot adds to the same cells
+static void apt_table_decay(void)
+{
+  int_master_status_t status;
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    status = critical_enter();
+    for (uint16_t ch = 0; ch < QL_NUM_CHANNEL_OFFSETS; ch++){
+      uint16_t *occupancy = &apt_occupancy[QL_ACTION(ts, ch)];
+      *occupancy -= (*occupancy + (1 << QL_APT_DECAY_SHIFT) - 1) >> QL_APT_DECAY_SHIFT;
+    }
+    // rounding may reorder close timeslots
+    tsch_ql_index_update(&apt_index, ts);
+    critical_exit(status);
+  }
+  apt_changed = 1;
+}
+
+// return the apt-table as 8-bit values (QL_APT_TABLE_FULL and above read as 255), copied one timeslot
+// at a time in a critical section so that the Rx slot does not change a timeslot half-way
 uint8_t * get_apt_table()
 {
+  int_master_status_t status;
+  for (uint16_t ts = 0; ts < UNICAST_SLOTFRAME_LENGTH; ts++){
+    status = critical_enter();
+    for (uint16_t ch = 0; ch < QL_NUM_CHANNEL_OFFSETS; ch++){
+      uint16_t i = QL_ACTION(ts, ch);
+      apt_table[i] = MIN(0xff, (uint32_t)apt_occupancy[i] * 0xff / QL_APT_TABLE_FULL);
+    }
+    critical_exit(status);
+  }
   return apt_table;
 }
 
-// function to return a slot number with the lowest value
-uint8_t get_slot_with_apt_table_min_value()
+// return the occupancy estimates
+const uint16_t * get_apt_occupancy()
+{
+  return apt_occupancy;
+}
+
+// return the energy and CRC-failure counters of a timeslot
+const struct tsch_ql_rx_noise * get_apt_rx_noise(uint16_t timeslot)
+{
+  return &apt_rx_noise[timeslot];
+}
+
+// return the number of frames received in a timeslot (wrapping)
+uint16_t get_apt_rx_frames(uint16_t timeslot)
+{
+  return apt_rx_frames[timeslot];
+}
+
+// function to return a timeslot with the lowest value (all channel offsets summed up)
+uint16_t get_slot_with_apt_table_min_value()
+{
+  uint16_t timeslot;
+  // the Rx slot updates the index, a short critical section instead of the TSCH lock
+  int_master_status_t status = critical_enter();
+  timeslot = tsch_ql_index_best(&apt_index);
+  critical_exit(status);
+  return timeslot;
+}
+
+// same, but skip the timeslots set in a bitmap (bit ts % 8 of byte ts / 8), unless all of them are set
+uint16_t get_slot_with_apt_table_min_value_excluding(const uint8_t *excluded)
+{
+  uint16_t excluded_ts[UNICAST_SLOTFRAME_LENGTH];
+  uint16_t num_excluded = 0;
+  uint16_t timeslot;
+  int_master_status_t status;
+
+  for (uint16_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+    if (excluded[i / 8] & (1 << (i % 8))) excluded_ts[num_excluded++] = i;
+  }
+  if (num_excluded == 0 || num_excluded == UNICAST_SLOTFRAME_LENGTH){
+    return get_slot_with_apt_table_min_value();
+  }
+
+  // the Rx slot updates the index, keep it out while entries are excluded: O(excluded * log N)
+  // with interrupts disabled, the bitmap was turned into a list before
+  status = critical_enter();
+  for (uint16_t i = 0; i < num_excluded; i++){
+    tsch_ql_index_exclude(&apt_index, excluded_ts[i]);
+  }
+  timeslot = tsch_ql_index_best(&apt_index);
+  for (uint16_t i = 0; i < num_excluded; i++){
+    tsch_ql_index_include(&apt_index, excluded_ts[i]);
+  }
+  critical_exit(status);
+
+  return timeslot;
+}
+
+// draw a timeslot with a probability inversely related to its occupancy, skipping the timeslots
+// set in a bitmap (NULL: none), so that nodes exploring at the same time spread out
+uint16_t get_slot_with_apt_table_weighted(const uint8_t *excluded)
 {
-  uint8_t min = random_rand() % UNICAST_SLOTFRAME_LENGTH;
-  for (uint8_t i = 1; i < UNICAST_SLOTFRAME_LENGTH; i++){
-    if (apt_table[i] < apt_table[min]){
-      min = i;
+  uint8_t none[(UNICAST_SLOTFRAME_LENGTH + 7) / 8];
+
+  if (excluded == NULL){
+    memset(none, 0, sizeof(none));
+    excluded = none;
+  }
+  if (apt_changed || memcmp(excluded, apt_alias_excluded, sizeof(apt_alias_excluded)) != 0){
+    // cleared before the loads are copied, so receptions during the rebuild are picked up by the next one
+    apt_changed = 0;
+    memcpy(apt_alias_excluded, excluded, sizeof(apt_alias_excluded));
+    for (uint16_t i = 0; i < UNICAST_SLOTFRAME_LENGTH; i++){
+      uint32_t weight = (excluded[i / 8] & (1 << (i % 8))) ? 0 :
+                        ((uint32_t)QL_APT_ONE << 8) / (apt_timeslot_load_copy(i) + QL_APT_SAMPLER_FLOOR);
+      apt_alias_weights[i] = weight > 0xffff ? 0xffff : weight;
     }
+    tsch_ql_alias_build(&apt_alias, apt_alias_weights);
+  }
+  if (apt_alias.total == 0){
+    // everything is excluded
+    return get_slot_with_apt_table_min_value();
+  }
+  return tsch_ql_alias_draw(&apt_alias);
+}
+
+// event posted to the registered process at every boundary of its slotframe
+process_event_t tsch_ql_slotframe_event;
+
+// registered process and the slotframe whose boundaries it follows
+static struct process *ql_slotframe_process = NULL;
+static uint16_t ql_slotframe_handle;
+
+// ASN of the next slotframe boundary, tracking restarts after every (re)sync
+static struct tsch_asn_t ql_next_boundary_asn;
+static uint8_t ql_boundary_asn_valid = 0;
+
+// summary carried by the event, the slot operation does not touch it while pending
+static struct tsch_ql_slotframe_summary ql_summary;
+static volatile uint8_t ql_summary_pending = 0;
+// the summary is ready but not posted yet
+static volatile uint8_t ql_summary_to_post = 0;
+
+// slotframes since the last APT decay, and a decay left to the process
+static uint16_t ql_apt_decay_slotframes = 0;
+static volatile uint8_t ql_apt_decay_pending = 0;
+
+// posts the boundary event and ages the APT from process context on behalf of the slot operation
+PROCESS(tsch_ql_slotframe_process, "QL-TSCH slotframe boundary");
+
+PROCESS_THREAD(tsch_ql_slotframe_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    if (ql_apt_decay_pending){
+      ql_apt_decay_pending = 0;
+      apt_table_decay();
+    }
+    if (ql_summary_to_post){
+      ql_summary_to_post = 0;
+      if (ql_slotframe_process == NULL ||
+          process_post(ql_slotframe_process, tsch_ql_slotframe_event, &ql_summary) != PROCESS_ERR_OK){
+        ql_summary_pending = 0;
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+
+// register a process for the boundary event of a slotframe
+void tsch_ql_register_slotframe_process(struct process *p, uint16_t slotframe_handle)
+{
+  if (!process_is_running(&tsch_ql_slotframe_process)){
+    tsch_ql_slotframe_event = process_alloc_event();
+    ringbufindex_init(&tx_outcome_ringbuf, QL_TX_OUTCOME_RING_SIZE);
+    process_start(&tsch_ql_slotframe_process, NULL);
+  }
+  ql_slotframe_handle = slotframe_handle;
+  ql_boundary_asn_valid = 0;
+  ql_summary_pending = 0;
+  ql_summary_to_post = 0;
+  ql_slotframe_process = p;
+}
+
+// the registered process is done with the summary of the last event
+void tsch_ql_slotframe_summary_done()
+{
+  ql_summary_pending = 0;
+}
+
+// take the oldest Tx outcome out of the ring (single consumer)
+int tsch_ql_get_tx_outcome(struct tsch_ql_tx_outcome *outcome)
+{
+  int get_index = ringbufindex_peek_get(&tx_outcome_ringbuf);
+  if (get_index == -1){
+    return 0;
+  }
+  *outcome = tx_outcome_array[get_index];
+  ringbufindex_get(&tx_outcome_ringbuf);
+  return 1;
+}
+
+// add a Tx outcome to the ring (single producer, the Tx slot)
+static struct tsch_ql_tx_outcome *ql_put_tx_outcome(void)
+{
+  int put_index;
+  if (ql_slotframe_process == NULL){
+    return NULL;
+  }
+  put_index = ringbufindex_peek_put(&tx_outcome_ringbuf);
+  if (put_index == -1){
+    ql_tx_dropped++;
+    return NULL;
+  }
+  return &tx_outcome_array[put_index];
+}
+
+// timeslot of the next slot in the registered slotframe
+static struct tsch_ql_asn_cursor ql_boundary_cursor;
+
+// slots skipped per cause and slotframe (the last column counts the other handles)
+static uint32_t ql_skipped_slots[TSCH_QL_SKIP_NUM][QL_SKIPPED_SLOTS_HANDLES + 1];
+
+// count a skipped slot of a link (NULL: no link), the locked wake-ups all go to the last column
+static void ql_count_skipped_slot(enum tsch_ql_skip_cause cause, const struct tsch_link *link)
+{
+  uint16_t column = TSCH_QL_SKIP_OTHER_HANDLE;
+  if (cause != TSCH_QL_SKIP_LOCKED && link != NULL && link->slotframe_handle < QL_SKIPPED_SLOTS_HANDLES){
+    column = link->slotframe_handle;
+  }
+  ql_skipped_slots[cause][column]++;
+}
+
+// return the number of slots skipped for a cause in a slotframe since the start (or the last reset)
+uint32_t tsch_ql_get_skipped_slots(enum tsch_ql_skip_cause cause, uint16_t slotframe_handle)
+{
+  uint32_t count;
+  // the counters are written from the rtimer interrupt, a 32-bit read may not be atomic
+  int_master_status_t status = critical_enter();
+  count = ql_skipped_slots[cause][cause == TSCH_QL_SKIP_LOCKED ? TSCH_QL_SKIP_OTHER_HANDLE :
+                                  MIN(slotframe_handle, TSCH_QL_SKIP_OTHER_HANDLE)];
+  critical_exit(status);
+  return count;
+}
+
+// set the skipped slot counters back to 0
+void tsch_ql_reset_skipped_slots()
+{
+  int_master_status_t status = critical_enter();
+  memset(ql_skipped_slots, 0, sizeof(ql_skipped_slots));
+  critical_exit(status);
+}
+
+// radio-on time per cell, per link type and in total (rtimer ticks)
+#define QL_RADIO_ON_LINK_TYPES (LINK_TYPE_ADVERTISING_ONLY + 1)
+static uint32_t ql_radio_on_cells[QL_RADIO_ON_HANDLES][QL_RADIO_ON_TIMESLOTS];
+static uint32_t ql_radio_on_link_types[QL_RADIO_ON_LINK_TYPES];
+static uint32_t ql_radio_on_total;
+// radio-on time of the current slot, for the Tx outcome
+static uint32_t ql_radio_on_slot;
+
+// when the radio was turned on by the slot operation
+static uint8_t ql_radio_is_on;
+#if ENERGEST_ON
+static uint64_t ql_radio_on_start;
+#else
+static rtimer_clock_t ql_radio_on_start;
+#endif /* ENERGEST_ON */
+
+// radio time so far: what Energest counted as listen and transmit time, otherwise the rtimer
+#if ENERGEST_ON
+#define QL_RADIO_TIME() (energest_type_time(ENERGEST_TYPE_LISTEN) + energest_type_time(ENERGEST_TYPE_TRANSMIT))
+#else
+#define QL_RADIO_TIME() RTIMER_NOW()
+#endif /* ENERGEST_ON */
+
+// the slot operation turned the radio on
+static void ql_radio_on_begin(void)
+{
+  if (!ql_radio_is_on){
+    ql_radio_is_on = 1;
+    ql_radio_on_start = QL_RADIO_TIME();
   }
-  return min;
 }
 
-// reset Tx slot status to 0
-uint8_t get_and_reset_Tx_slot_status()
+// the slot operation turned the radio off: charge the time to the link of the current slot
+static void ql_radio_on_end(void)
 {
-  uint8_t tmp = trans_status;
-  trans_status = 0;
-  return tmp;
+  uint32_t elapsed;
+  if (!ql_radio_is_on){
+    return;
+  }
+  ql_radio_is_on = 0;
+  /* Energest counts the listen time when the radio is turned off, so read it after NETSTACK_RADIO.off() */
+  elapsed = (uint32_t)(QL_RADIO_TIME() - ql_radio_on_start);
+  ql_radio_on_total += elapsed;
+  ql_radio_on_slot += elapsed;
+  if (current_link == NULL){
+    return;
+  }
+  if (current_link->link_type < QL_RADIO_ON_LINK_TYPES){
+    ql_radio_on_link_types[current_link->link_type] += elapsed;
+  }
+  if (current_link->slotframe_handle < QL_RADIO_ON_HANDLES && current_link->timeslot < QL_RADIO_ON_TIMESLOTS){
+    ql_radio_on_cells[current_link->slotframe_handle][current_link->timeslot] += elapsed;
+  }
+}
+
+// read a counter written from the rtimer interrupt (a 32-bit read may not be atomic)
+static uint32_t ql_radio_on_read(const uint32_t *counter)
+{
+  uint32_t value;
+  int_master_status_t status = critical_enter();
+  value = *counter;
+  critical_exit(status);
+  return value;
+}
+
+// radio-on time of a timeslot of a slotframe
+uint32_t tsch_ql_get_radio_on_cell(uint16_t slotframe_handle, uint16_t timeslot)
+{
+  if (slotframe_handle >= QL_RADIO_ON_HANDLES || timeslot >= QL_RADIO_ON_TIMESLOTS){
+    return 0;
+  }
+  return ql_radio_on_read(&ql_radio_on_cells[slotframe_handle][timeslot]);
+}
+
+// radio-on time of the links of a type
+uint32_t tsch_ql_get_radio_on_link_type(enum link_type link_type)
+{
+  if (link_type >= QL_RADIO_ON_LINK_TYPES){
+    return 0;
+  }
+  return ql_radio_on_read(&ql_radio_on_link_types[link_type]);
+}
+
+// radio-on time of all the slots
+uint32_t tsch_ql_get_radio_on_total()
+{
+  return ql_radio_on_read(&ql_radio_on_total);
+}
+
+// called from the slot operation once the ASN of the next slot is known
+static void ql_check_slotframe_boundary(void)
+{
+  struct tsch_slotframe *sf;
+  uint16_t offset;
+
+  if (ql_slotframe_process == NULL){
+    return;
+  }
+  if (ql_boundary_asn_valid && (int32_t)TSCH_ASN_DIFF(tsch_current_asn, ql_next_boundary_asn) < 0){
+    return;
+  }
+  // the slotframe list is only walked once per boundary, not in every slot
+  sf = tsch_schedule_get_slotframe_by_handle(ql_slotframe_handle);
+  if (sf == NULL){
+    return;
+  }
+
+  offset = tsch_ql_asn_mod(&ql_boundary_cursor, &tsch_current_asn, &sf->size);
+  // the counters keep adding up until the last summary is consumed
+  if (ql_boundary_asn_valid && !ql_summary_pending){
+    ql_summary.asn = tsch_current_asn;
+    TSCH_ASN_DEC(ql_summary.asn, offset);
+    ql_summary.tx_ok = ql_tx_ok;
+    ql_summary.tx_failed = ql_tx_failed;
+    ql_summary.tx_dropped = ql_tx_dropped;
+    ql_tx_ok = 0;
+    ql_tx_failed = 0;
+    ql_tx_dropped = 0;
+    ql_summary_pending = 1;
+    ql_summary_to_post = 1;
+    process_poll(&tsch_ql_slotframe_process);
+  }
+  // the decay itself is O(N), it is left to the process
+  if (ql_boundary_asn_valid && ++ql_apt_decay_slotframes >= QL_APT_DECAY_PERIOD){
+    ql_apt_decay_slotframes = 0;
+    ql_apt_decay_pending = 1;
+    process_poll(&tsch_ql_slotframe_process);
+  }
+  ql_next_boundary_asn = tsch_current_asn;
+  TSCH_ASN_DEC(ql_next_boundary_asn, offset);
+  TSCH_ASN_INC(ql_next_boundary_asn, sf->size.val);
+  ql_boundary_asn_valid = 1;
 }
 #endif /* QL_TSCH_ENABLED */
 
@@ -351,6 +807,12 @@ tsch_get_lock(void)
 void
 tsch_release_lock(void)
 {
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR
+  /* The schedule is only changed with the lock held (or by the queued commands) */
+  tsch_schedule_calendar_invalidate();
+#endif /* QL_TSCH_ENABLED && QL_SCHEDULE_CALENDAR */
+/**************************** My modifications - End **********************************/
   tsch_locked = 0;
 }
 
@@ -385,7 +847,15 @@ static uint8_t
 tsch_calculate_channel(struct tsch_asn_t *asn, uint16_t channel_offset)
 {
   uint16_t index_of_0, index_of_offset;
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+  /* Hopping sequence index, advanced along with the ASN */
+  static struct tsch_ql_asn_cursor hopping_cursor;
+  index_of_0 = tsch_ql_asn_mod(&hopping_cursor, asn, &tsch_hopping_sequence_length);
+#else
   index_of_0 = TSCH_ASN_MOD(*asn, tsch_hopping_sequence_length);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
   index_of_offset = (index_of_0 + channel_offset) % tsch_hopping_sequence_length.val;
   return tsch_hopping_sequence[index_of_offset];
 }
@@ -443,6 +913,19 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
   RTIMER_BUSYWAIT_UNTIL_ABS(0, ref_time, offset);
   return 0;
 }
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+// schedule the wake-up for the next active slot, counting the slot as skipped if it was missed
+static uint8_t ql_schedule_next_slot(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_clock_t offset)
+{
+  if (tsch_schedule_slot_operation(tm, ref_time, offset, "main")){
+    return 1;
+  }
+  ql_count_skipped_slot(TSCH_QL_SKIP_TIMER_MISS, current_link);
+  return 0;
+}
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
 /*---------------------------------------------------------------------------*/
 /* Schedule slot operation conditionally, and YIELD if success only.
  * Always attempt to schedule RTIMER_GUARD before the target to make sure to wake up
@@ -557,6 +1040,11 @@ tsch_radio_on(enum tsch_radio_state_on_cmd command)
   }
   if(do_it) {
     NETSTACK_RADIO.on();
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+    ql_radio_on_begin();
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -588,6 +1076,11 @@ tsch_radio_off(enum tsch_radio_state_off_cmd command)
   }
   if(do_it) {
     NETSTACK_RADIO.off();
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+    ql_radio_on_end();
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -652,6 +1145,11 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       burst_link_requested = 0;
       if(do_wait_for_ack
              && tsch_current_burst_count + 1 < TSCH_BURST_MAX_LEN
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+             && QL_BURST_ALLOWED(current_link)
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
              && tsch_queue_nbr_packet_count(current_neighbor) > 1) {
         burst_link_requested = 1;
         tsch_packet_set_frame_pending(packet, packet_len);
@@ -679,8 +1177,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* LLSEC802154_ENABLED */
 
       /* prepare packet to send: copy to radio buffer */
+      TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_RADIO_PREPARE);
       if(packet_ready && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
         static rtimer_clock_t tx_duration;
+        TSCH_QL_PROFILE_END(TSCH_QL_PHASE_RADIO_PREPARE);
 
 #if TSCH_CCA_ENABLED
         cca_status = 1;
@@ -703,7 +1203,9 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
           TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
           /* send packet already in radio tx buffer */
+          TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_TX);
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
+          TSCH_QL_PROFILE_END(TSCH_QL_PHASE_TX);
           tx_count++;
           /* Save tx timestamp */
           tx_start_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
@@ -724,6 +1226,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               uint8_t ack_hdrlen;
               frame802154_t frame;
 
+              TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_ACK_WAIT);
 #if TSCH_HW_FRAME_FILTERING
               radio_value_t radio_rx_mode;
               /* Entering promiscuous mode so that the radio accepts the enhanced ACK */
@@ -756,6 +1259,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
               /* Read ack frame */
               ack_len = NETSTACK_RADIO.read((void *)ackbuf, sizeof(ackbuf));
+              TSCH_QL_PROFILE_END(TSCH_QL_PHASE_ACK_WAIT);
 
               is_time_source = 0;
               /* The radio driver should return 0 if no valid packets are in the rx buffer */
@@ -810,6 +1314,18 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                 }
                 mac_tx_status = MAC_TX_OK;
 
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+                {
+                  radio_value_t v;
+                  NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &v);
+                  ql_ack_rssi = (int8_t)v;
+                  NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_LINK_QUALITY, &v);
+                  ql_ack_lqi = (uint8_t)v;
+                }
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
+
                 /* We requested an extra slot and got an ack. This means
                 the extra slot will be scheduled at the received */
                 if(burst_link_requested) {
@@ -851,16 +1367,40 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
 #if QL_TSCH_ENABLED
   
+  TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_QL_HOOKS);
   if(current_link->slotframe_handle == 1) {
+    struct tsch_ql_tx_outcome *outcome = ql_put_tx_outcome();
     if (mac_tx_status == MAC_TX_OK)
     {
-      trans_status = 1;
+      ql_tx_ok++;
     } else /*if (mac_tx_status == MAC_TX_COLLISION || mac_tx_status == MAC_TX_NOACK ||
               mac_tx_status == MAC_TX_ERR_FATAL || mac_tx_status == MAC_TX_ERR) */
     {
-      trans_status = 2;
+      ql_tx_failed++;
+    }
+    if (outcome != NULL){
+      outcome->asn = tsch_current_asn;
+      outcome->timeslot = current_link->timeslot;
+      outcome->channel_offset = current_link->channel_offset;
+      outcome->status = mac_tx_status == MAC_TX_OK ? 1 : 2;
+      outcome->mac_tx_status = mac_tx_status;
+      outcome->transmissions = current_packet->transmissions;
+      outcome->last_tx = mac_tx_status == MAC_TX_OK ||
+                         current_packet->transmissions >= current_packet->max_transmissions;
+      // the ACK values are only valid when this Tx got an ACK
+      outcome->ack_rssi = mac_tx_status == MAC_TX_OK ? ql_ack_rssi : 0;
+      outcome->ack_lqi = mac_tx_status == MAC_TX_OK ? ql_ack_lqi : 0;
+      outcome->queue_delay = (uint16_t)tsch_current_asn.ls4b -
+                             (uint16_t)queuebuf_attr(current_packet->qb, PACKETBUF_ATTR_TIMESTAMP);
+      outcome->radio_on = ql_radio_on_slot > 0xffff ? 0xffff : ql_radio_on_slot;
+      // the continuation slots of a burst replay the link, so they are credited to its cell
+      outcome->burst = tsch_current_burst_count;
+      ringbufindex_put(&tx_outcome_ringbuf);
     }
+    ql_ack_rssi = 0;
+    ql_ack_lqi = 0;
   }
+  TSCH_QL_PROFILE_END(TSCH_QL_PHASE_QL_HOOKS);
 #endif /* QL_TSCH_ENABLED */
 /**************************** My modifications - End **********************************/
 
@@ -958,6 +1498,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
           current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] + RADIO_DELAY_BEFORE_DETECT);
     }
     if(!packet_seen) {
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      if(QL_APT_CELL(current_link)) {
+        apt_table_sample_energy(current_link);
+      }
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
       /* no packets on air */
       tsch_radio_off(TSCH_RADIO_CMD_OFF_FORCE);
     } else {
@@ -978,6 +1525,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
         radio_value_t radio_last_rssi;
         radio_value_t radio_last_lqi;
 
+        TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_RX_PROCESSING);
         /* Read packet */
         current_input->len = NETSTACK_RADIO.read((void *)current_input->payload, TSCH_PACKET_MAX_LEN);
         NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &radio_last_rssi);
@@ -1002,6 +1550,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
           TSCH_LOG_ADD(tsch_log_message,
               snprintf(log->message, sizeof(log->message),
               "!failed to parse frame %u %u", header_len, current_input->len));
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+          if(QL_APT_CELL(current_link)) {
+            apt_table_add_crc_failure(current_link);
+          }
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
         }
 
         if(frame_valid) {
@@ -1121,8 +1676,14 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 
 #if QL_TSCH_ENABLED
   // update APT-table based on the reception
-  if(current_link->slotframe_handle == 1) {
-    apt_table[current_link->timeslot] += 1;
+  if(QL_APT_CELL(current_link)) {
+    TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_QL_HOOKS);
+    apt_table_add(current_link->timeslot, current_link->channel_offset, QL_APT_ONE);
+    TSCH_QL_PROFILE_END(TSCH_QL_PHASE_QL_HOOKS);
+  }
+  // the frames of a burst also show that a neighbour uses the cell
+  if(current_link->slotframe_handle == 1 && current_link->timeslot < UNICAST_SLOTFRAME_LENGTH) {
+    apt_rx_frames[current_link->timeslot]++;
   }
 #endif /* QL_TSCH_ENABLED */
 
@@ -1153,7 +1714,16 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
           /* Poll process for processing of pending input and logs */
           process_poll(&tsch_pending_events_process);
         }
+        TSCH_QL_PROFILE_END(TSCH_QL_PHASE_RX_PROCESSING);
+      }
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      else if(QL_APT_CELL(current_link)) {
+        /* A frame was on air but the radio dropped it (bad CRC) */
+        apt_table_add_crc_failure(current_link);
       }
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
 
       tsch_radio_off(TSCH_RADIO_CMD_OFF_END_OF_TIMESLOT);
     }
@@ -1182,6 +1752,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
 
   /* Loop over all active slots */
   while(tsch_is_associated) {
+    TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_SLOT);
 
     if(current_link == NULL || tsch_lock_requested) { /* Skip slot operation if there is no link
                                                           or if there is a pending request for getting the lock */
@@ -1193,18 +1764,39 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
                             tsch_lock_requested,
                             current_link == NULL);
       );
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      /* The link lookup returns NULL while the lock is held, so the lock is
+       * checked first: those slots are lost to the lock, not to the schedule.
+       * Which cell they would have served is not known, they count globally */
+      if(tsch_locked) {
+        ql_count_skipped_slot(TSCH_QL_SKIP_LOCKED, NULL);
+      } else if(tsch_lock_requested) {
+        ql_count_skipped_slot(TSCH_QL_SKIP_LOCK_REQUESTED, current_link);
+      } else {
+        ql_count_skipped_slot(TSCH_QL_SKIP_NO_LINK, NULL);
+      }
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
 
     } else {
       int is_active_slot;
       TSCH_DEBUG_SLOT_START();
       tsch_in_slot_operation = 1;
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      ql_radio_on_slot = 0;
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
       /* Measure on-air noise level while TSCH is idle */
       tsch_stats_sample_rssi();
       /* Reset drift correction */
       drift_correction = 0;
       is_drift_correction_used = 0;
       /* Get a packet ready to be sent */
+      TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_PACKET_FETCH);
       current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
+      TSCH_QL_PROFILE_END(TSCH_QL_PHASE_PACKET_FETCH);
       uint8_t do_skip_best_link = 0;
       if(current_packet == NULL && backup_link != NULL) {
         /* There is no packet to send, and this link does not have Rx flag. Instead of doing
@@ -1286,6 +1878,14 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       rtimer_clock_t prev_slot_start;
       /* Time to next wake up */
       rtimer_clock_t time_to_next_active_slot;
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      /* Safe point between two slots: apply the queued schedule changes */
+      TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_QL_HOOKS);
+      tsch_schedule_apply_commands();
+      TSCH_QL_PROFILE_END(TSCH_QL_PHASE_QL_HOOKS);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
       /* Schedule next wakeup skipping slots if missed deadline */
       do {
         update_link_backoff(current_link);
@@ -1299,7 +1899,9 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
           tsch_current_burst_count++;
         } else {
           /* Get next active link */
+          TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_LINK_LOOKUP);
           current_link = tsch_schedule_get_next_active_link(&tsch_current_asn, &timeslot_diff, &backup_link);
+          TSCH_QL_PROFILE_END(TSCH_QL_PHASE_LINK_LOOKUP);
           if(current_link == NULL) {
             /* There is no next link. Fall back to default
              * behavior: wake up at the next slot. */
@@ -1321,9 +1923,24 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
         /* Update current slot start */
         prev_slot_start = current_slot_start;
         current_slot_start += time_to_next_active_slot;
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      } while(!ql_schedule_next_slot(t, prev_slot_start, time_to_next_active_slot));
+#else
       } while(!tsch_schedule_slot_operation(t, prev_slot_start, time_to_next_active_slot, "main"));
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
+
+/**************************** My modifications - Start ********************************/
+#if QL_TSCH_ENABLED
+      TSCH_QL_PROFILE_BEGIN(TSCH_QL_PHASE_QL_HOOKS);
+      ql_check_slotframe_boundary();
+      TSCH_QL_PROFILE_END(TSCH_QL_PHASE_QL_HOOKS);
+#endif /* QL_TSCH_ENABLED */
+/**************************** My modifications - End **********************************/
     }
 
+    TSCH_QL_PROFILE_END(TSCH_QL_PHASE_SLOT);
     tsch_in_slot_operation = 0;
     PT_YIELD(&slot_operation_pt);
   }
@@ -1375,6 +1992,9 @@ tsch_slot_operation_sync(rtimer_clock_t next_slot_start,
   tsch_last_sync_time = clock_time();
   critical_exit(status);
   current_link = NULL;
+#if QL_TSCH_ENABLED
+  ql_boundary_asn_valid = 0;
+#endif /* QL_TSCH_ENABLED */
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -117,14 +117,101 @@ void lock_queue_rx();
 // reset the values of APT table when requested
 void reset_apt_table();
 
-// return apt table
+// return apt table (occupancy scaled to 0-255, QL_APT_TABLE_FULL and above read as 255, kept for compatibility)
 uint8_t * get_apt_table();
 
-// function to return a slot number with the lowest value
-uint8_t get_slot_with_apt_table_min_value();
-
-// reset Tx slot status to 0
-uint8_t get_and_reset_Tx_slot_status();
+// return the occupancy estimates of the cells, QL_APT_ONE means one reception per decay period
+// (QL_APT_DECAY_PERIOD slotframes), updated by the Rx slot: read them in a critical section from process context
+const uint16_t * get_apt_occupancy();
+
+// transmissions heard in an Rx timeslot of the unicast slotframe that could not be received
+struct tsch_ql_rx_noise {
+  uint16_t energy;        /* idle Rx with RSSI above QL_APT_ENERGY_THRESHOLD */
+  uint16_t crc_failures;  /* frame dropped by the radio or not parsable */
+};
+
+// return the energy and CRC-failure counters of a timeslot
+const struct tsch_ql_rx_noise * get_apt_rx_noise(uint16_t timeslot);
+
+// return the number of frames received in a timeslot of the unicast slotframe (wrapping)
+uint16_t get_apt_rx_frames(uint16_t timeslot);
+
+// function to return a timeslot with the lowest value (all channel offsets summed up)
+uint16_t get_slot_with_apt_table_min_value();
+
+// same, but skip the timeslots set in a bitmap (bit ts % 8 of byte ts / 8), unless all of them are set
+uint16_t get_slot_with_apt_table_min_value_excluding(const uint8_t *excluded);
+
+// draw a timeslot with a probability inversely related to its occupancy (O(1) alias sampler),
+// skipping the timeslots set in a bitmap (NULL: none)
+uint16_t get_slot_with_apt_table_weighted(const uint8_t *excluded);
+
+// outcome of one Tx in the QL slotframe
+struct tsch_ql_tx_outcome {
+  struct tsch_asn_t asn;  /* ASN of the Tx */
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint8_t status;         /* 1 success, 2 failure */
+  uint8_t mac_tx_status;  /* MAC_TX_OK, MAC_TX_NOACK, MAC_TX_COLLISION, ... */
+  uint8_t transmissions;  /* transmissions of the packet so far, this one included */
+  uint8_t last_tx;        /* 1 when the packet leaves the queue after this Tx (acked or out of retries) */
+  int8_t ack_rssi;        /* RSSI and LQI of the ACK, 0 when no ACK was received */
+  uint8_t ack_lqi;
+  uint16_t queue_delay;   /* timeslots the packet spent in the queue */
+  uint16_t radio_on;      /* rtimer ticks the radio was on for this Tx (frame and ACK wait) */
+  uint8_t burst;          /* position in a burst, 0 for the Tx in the cell itself */
+};
+
+// Tx counters of one cycle of the QL slotframe, carried by tsch_ql_slotframe_event.
+// The outcomes themselves are read with tsch_ql_get_tx_outcome()
+struct tsch_ql_slotframe_summary {
+  struct tsch_asn_t asn; /* ASN of the boundary that was crossed */
+  uint16_t tx_ok;
+  uint16_t tx_failed;
+  uint16_t tx_dropped;   /* outcomes lost because the ring was full */
+};
+
+// event posted at every boundary of the registered slotframe, data is the summary
+extern process_event_t tsch_ql_slotframe_event;
+
+// register a process for the boundary event of a slotframe
+void tsch_ql_register_slotframe_process(struct process *p, uint16_t slotframe_handle);
+
+// the registered process is done with the summary of the last event
+void tsch_ql_slotframe_summary_done();
+
+// take the oldest Tx outcome out of the ring, returns 0 if there is none
+int tsch_ql_get_tx_outcome(struct tsch_ql_tx_outcome *outcome);
+
+// why the slot operation did not run a scheduled slot
+enum tsch_ql_skip_cause {
+  TSCH_QL_SKIP_LOCKED,          /* the lock was held, one global count (see below) */
+  TSCH_QL_SKIP_LOCK_REQUESTED,  /* a process was waiting for the lock */
+  TSCH_QL_SKIP_NO_LINK,         /* woke up without a link (nothing scheduled) */
+  TSCH_QL_SKIP_TIMER_MISS,      /* the wake-up for the slot was already in the past */
+  TSCH_QL_SKIP_NUM
+};
+
+// the counter shared by the slotframes from QL_SKIPPED_SLOTS_HANDLES on and the slots without a link
+#define TSCH_QL_SKIP_OTHER_HANDLE QL_SKIPPED_SLOTS_HANDLES
+
+// return the number of slots skipped for a cause in a slotframe since the start (or the last reset).
+// No link is looked up while the lock is held and the slot operation wakes up in every timeslot,
+// so TSCH_QL_SKIP_LOCKED counts these wake-ups for all slotframes together, scheduled cell or not:
+// its count is returned for any slotframe_handle
+uint32_t tsch_ql_get_skipped_slots(enum tsch_ql_skip_cause cause, uint16_t slotframe_handle);
+
+// set the skipped slot counters back to 0
+void tsch_ql_reset_skipped_slots();
+
+// radio-on time in rtimer ticks since the start (Energest listen and transmit time if Energest is on),
+// the counters wrap after 2^32 ticks
+// of a timeslot of a slotframe, 0 for the timeslots that are not accounted (see QL_RADIO_ON_HANDLES)
+uint32_t tsch_ql_get_radio_on_cell(uint16_t slotframe_handle, uint16_t timeslot);
+// of the links of a type (LINK_TYPE_NORMAL, LINK_TYPE_ADVERTISING, LINK_TYPE_ADVERTISING_ONLY)
+uint32_t tsch_ql_get_radio_on_link_type(enum link_type link_type);
+// of all the slots
+uint32_t tsch_ql_get_radio_on_total();
 
 // #endif /* QL_TSCH_ENABLED */
 
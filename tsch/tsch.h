@@ -78,6 +78,220 @@ frequency hopping for enhanced reliability.
 #define QL_TSCH_ENABLED 0
 #endif
 
+// number of channel offsets used by QL-TSCH in the unicast slotframe
+#ifdef QL_NUM_CHANNEL_OFFSETS_CONF
+#define QL_NUM_CHANNEL_OFFSETS QL_NUM_CHANNEL_OFFSETS_CONF
+#else
+#define QL_NUM_CHANNEL_OFFSETS 1
+#endif
+
+// longest burst (frames sent back to back with the frame pending bit) starting from a Tx cell of the
+// QL slotframe, 1 disables them there; the other slotframes keep the TSCH_BURST_MAX_LEN of TSCH
+#ifdef QL_BURST_MAX_LEN_CONF
+#define QL_BURST_MAX_LEN QL_BURST_MAX_LEN_CONF
+#else
+#define QL_BURST_MAX_LEN TSCH_BURST_MAX_LEN
+#endif
+
+// number of Tx outcome records buffered between the slot operation and the scheduler (power of two)
+#ifdef QL_TX_OUTCOME_RING_SIZE_CONF
+#define QL_TX_OUTCOME_RING_SIZE QL_TX_OUTCOME_RING_SIZE_CONF
+#else
+#define QL_TX_OUTCOME_RING_SIZE 16
+#endif
+
+// APT occupancy of a cell: exponentially weighted rate of receptions per decay period, QL_APT_ONE is
+// one reception per period and several receptions per period add up beyond it (saturating at 0xffff).
+// It decays by 2^-QL_APT_DECAY_SHIFT every QL_APT_DECAY_PERIOD unicast slotframes (shift 3: ~8 periods memory)
+#define QL_APT_ONE 256
+#ifdef QL_APT_DECAY_SHIFT_CONF
+#define QL_APT_DECAY_SHIFT QL_APT_DECAY_SHIFT_CONF
+#else
+#define QL_APT_DECAY_SHIFT 3
+#endif
+
+// unicast slotframes between two decays of the APT, match it to the traffic period so that a cell used
+// by a neighbour once per packet does not look idle between two packets
+#ifdef QL_APT_DECAY_PERIOD_CONF
+#define QL_APT_DECAY_PERIOD QL_APT_DECAY_PERIOD_CONF
+#else
+#define QL_APT_DECAY_PERIOD 256
+#endif
+
+// occupancy read as 255 by the 8-bit view of get_apt_table(), lower values are scaled linearly
+#ifdef QL_APT_TABLE_FULL_CONF
+#define QL_APT_TABLE_FULL QL_APT_TABLE_FULL_CONF
+#else
+#define QL_APT_TABLE_FULL (4 * QL_APT_ONE)
+#endif
+
+// an idle Rx cell whose RSSI is above this (dBm) had a transmission that could not be decoded
+#ifdef QL_APT_ENERGY_THRESHOLD_CONF
+#define QL_APT_ENERGY_THRESHOLD QL_APT_ENERGY_THRESHOLD_CONF
+#else
+#define QL_APT_ENERGY_THRESHOLD -85
+#endif
+
+// how much energy without a frame and a corrupted frame weigh in the occupancy (QL_APT_ONE: like a reception)
+#ifdef QL_APT_ENERGY_WEIGHT_CONF
+#define QL_APT_ENERGY_WEIGHT QL_APT_ENERGY_WEIGHT_CONF
+#else
+#define QL_APT_ENERGY_WEIGHT (QL_APT_ONE / 2)
+#endif
+
+#ifdef QL_APT_CRC_WEIGHT_CONF
+#define QL_APT_CRC_WEIGHT QL_APT_CRC_WEIGHT_CONF
+#else
+#define QL_APT_CRC_WEIGHT QL_APT_ONE
+#endif
+
+// weighted exploration draws a timeslot with a weight of 1 / (occupancy + QL_APT_SAMPLER_FLOOR),
+// the floor bounds how much an idle timeslot is preferred over a busy one
+#ifdef QL_APT_SAMPLER_FLOOR_CONF
+#define QL_APT_SAMPLER_FLOOR QL_APT_SAMPLER_FLOOR_CONF
+#else
+#define QL_APT_SAMPLER_FLOOR (QL_APT_ONE / 8)
+#endif
+
+// number of queued schedule commands between process context and the slot operation (power of two)
+#ifdef QL_SCHEDULE_CMD_RING_SIZE_CONF
+#define QL_SCHEDULE_CMD_RING_SIZE QL_SCHEDULE_CMD_RING_SIZE_CONF
+#else
+#define QL_SCHEDULE_CMD_RING_SIZE 8
+#endif
+
+// look the next active link up in a calendar precompiled over the hyperperiod (LCM of the slotframe
+// lengths) instead of walking all the links at every slot, if the hyperperiod is at most MAX_LEN slots
+// (rebuilt in process context after a change, the links are walked meanwhile)
+#ifdef QL_SCHEDULE_CALENDAR_CONF
+#define QL_SCHEDULE_CALENDAR QL_SCHEDULE_CALENDAR_CONF
+#else
+#define QL_SCHEDULE_CALENDAR 0
+#endif
+
+#ifdef QL_SCHEDULE_CALENDAR_MAX_LEN_CONF
+#define QL_SCHEDULE_CALENDAR_MAX_LEN QL_SCHEDULE_CALENDAR_MAX_LEN_CONF
+#else
+#define QL_SCHEDULE_CALENDAR_MAX_LEN 128
+#endif
+
+// time the phases of the slot operation into histograms (QL_SLOT_PROFILE_BUCKETS logarithmic buckets,
+// the first one below QL_SLOT_PROFILE_BUCKET_TICKS)
+#ifdef QL_SLOT_PROFILE_CONF
+#define QL_SLOT_PROFILE QL_SLOT_PROFILE_CONF
+#else
+#define QL_SLOT_PROFILE 0
+#endif
+
+#ifdef QL_SLOT_PROFILE_BUCKETS_CONF
+#define QL_SLOT_PROFILE_BUCKETS QL_SLOT_PROFILE_BUCKETS_CONF
+#else
+#define QL_SLOT_PROFILE_BUCKETS 12
+#endif
+
+#ifdef QL_SLOT_PROFILE_BUCKET_TICKS_CONF
+#define QL_SLOT_PROFILE_BUCKET_TICKS QL_SLOT_PROFILE_BUCKET_TICKS_CONF
+#else
+#define QL_SLOT_PROFILE_BUCKET_TICKS US_TO_RTIMERTICKS(16)
+#endif
+
+// skipped slots are counted per slotframe for the handles below this, higher handles
+// and slots without a link share one more counter (slots lost to the lock are only counted in total)
+#ifdef QL_SKIPPED_SLOTS_HANDLES_CONF
+#define QL_SKIPPED_SLOTS_HANDLES QL_SKIPPED_SLOTS_HANDLES_CONF
+#else
+#define QL_SKIPPED_SLOTS_HANDLES 2
+#endif
+
+// radio-on time is accounted per timeslot for the slotframes with a handle below QL_RADIO_ON_HANDLES
+// and the timeslots below QL_RADIO_ON_TIMESLOTS, the other slots only add up to the totals
+#ifdef QL_RADIO_ON_HANDLES_CONF
+#define QL_RADIO_ON_HANDLES QL_RADIO_ON_HANDLES_CONF
+#else
+#define QL_RADIO_ON_HANDLES 2
+#endif
+
+#ifdef QL_RADIO_ON_TIMESLOTS_CONF
+#define QL_RADIO_ON_TIMESLOTS QL_RADIO_ON_TIMESLOTS_CONF
+#else
+#define QL_RADIO_ON_TIMESLOTS UNICAST_SLOTFRAME_LENGTH
+#endif
+
+// QL-TSCH actions are the (timeslot, channel offset) cells of the unicast slotframe
+#define QL_NUM_ACTIONS (UNICAST_SLOTFRAME_LENGTH * QL_NUM_CHANNEL_OFFSETS)
+#define QL_ACTION(timeslot, channel_offset) ((channel_offset) * UNICAST_SLOTFRAME_LENGTH + (timeslot))
+#define QL_ACTION_TIMESLOT(action) ((action) % UNICAST_SLOTFRAME_LENGTH)
+#define QL_ACTION_CHANNEL_OFFSET(action) ((action) / UNICAST_SLOTFRAME_LENGTH)
+
+#include "net/mac/tsch/tsch-ql-index.h"
+#include "net/mac/tsch/tsch-ql-alias.h"
+#include "net/mac/tsch/tsch-ql-asn.h"
+#include "net/mac/tsch/tsch-ql-profile.h"
+
+/**
+ * \brief Change the options, timeslot and channel offset of a link in place,
+ * without freeing and allocating it (tsch-schedule.h is not part of this tree)
+ * \param slotframe The slotframe of the link
+ * \param l The link to update
+ * \param link_options The new link options
+ * \param timeslot The new timeslot
+ * \param channel_offset The new channel offset
+ * \return 1 if success, 0 if failure
+ */
+int tsch_schedule_update_link(struct tsch_slotframe *slotframe, struct tsch_link *l,
+                              uint8_t link_options, uint16_t timeslot, uint16_t channel_offset);
+
+/* One in-place link change of tsch_schedule_update_links() */
+struct tsch_link_update {
+  struct tsch_link *link;
+  uint8_t link_options;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  struct tsch_neighbor *nbr; /* filled in by tsch_schedule_update_links() */
+};
+
+/**
+ * \brief Change several links of a slotframe in place under a single lock
+ * (e.g. a Tx cell and an Rx cell swapping places), nothing is changed unless all updates are valid
+ * \param slotframe The slotframe of the links
+ * \param updates The changes
+ * \param num The number of changes
+ * \return 1 if success, 0 if failure
+ */
+int tsch_schedule_update_links(struct tsch_slotframe *slotframe, struct tsch_link_update *updates, uint8_t num);
+
+/**
+ * \brief Queue adding a link, applied by the slot operation between two slots
+ * without taking the lock. The link is not known before it is applied, it is
+ * stored in *result then (if not NULL). An add queued again for the same result
+ * before that changes the link of the first add in place
+ * \return 1 if queued, 0 if the command ring is full or the timeslot is invalid
+ */
+int tsch_schedule_enqueue_add_link(struct tsch_slotframe *slotframe, uint8_t link_options,
+                                   enum link_type link_type, const linkaddr_t *address,
+                                   uint16_t timeslot, uint16_t channel_offset,
+                                   struct tsch_link **result);
+/**
+ * \brief Queue an in-place update of a link (see tsch_schedule_update_link),
+ * applied by the slot operation between two slots
+ * \return 1 if queued, 0 if the command ring is full or the timeslot is invalid
+ */
+int tsch_schedule_enqueue_update_link(struct tsch_slotframe *slotframe, struct tsch_link *l,
+                                      uint8_t link_options, uint16_t timeslot, uint16_t channel_offset);
+/**
+ * \brief Number of commands that can still be queued before the ring is full
+ */
+int tsch_schedule_enqueue_space(void);
+/**
+ * \brief Apply the queued schedule commands, called by the slot operation only
+ */
+void tsch_schedule_apply_commands(void);
+/**
+ * \brief Mark the schedule calendar as stale: the slot operation walks the links
+ * until tsch_ql_calendar_process has rebuilt it (may be called from the slot operation)
+ */
+void tsch_schedule_calendar_invalidate(void);
+
 #if RL_TSCH_ENABLED
 #include "customized-tsch-file.h"
 #include "q-learning.h"